@@ -0,0 +1,83 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <lib/stdint.h>
+
+typedef struct {
+	char signature[8];
+	uint8_t checksum;
+	char oem_id[6];
+	uint8_t revision;
+	uint32_t rsdt_address;
+	uint32_t length;
+	uint64_t xsdt_address;
+	uint8_t extended_checksum;
+	uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+	char signature[4];
+	uint32_t length;
+	uint8_t revision;
+	uint8_t checksum;
+	char oem_id[6];
+	char oem_table_id[8];
+	uint32_t oem_revision;
+	uint32_t creator_id;
+	uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+// MADT ("APIC"): адрес LAPIC и список контроллеров
+#define MADT_LAPIC 0
+#define MADT_IOAPIC 1
+#define MADT_ISO 2
+#define MADT_LAPIC_OVERRIDE 5
+
+#define MADT_LAPIC_ENABLED 0x01
+#define MADT_POLARITY_LOW 0x03
+#define MADT_TRIGGER_LEVEL 0x0C
+
+typedef struct {
+	acpi_sdt_header_t header;
+	uint32_t lapic_address;
+	uint32_t flags;
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct {
+	uint8_t type;
+	uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+typedef struct {
+	madt_entry_t entry;
+	uint8_t processor_id;
+	uint8_t apic_id;
+	uint32_t flags;
+} __attribute__((packed)) madt_lapic_t;
+
+typedef struct {
+	madt_entry_t entry;
+	uint8_t ioapic_id;
+	uint8_t reserved;
+	uint32_t address;
+	uint32_t gsi_base;
+} __attribute__((packed)) madt_ioapic_t;
+
+typedef struct {
+	madt_entry_t entry;
+	uint8_t bus;
+	uint8_t source;
+	uint32_t gsi;
+	uint16_t flags;
+} __attribute__((packed)) madt_iso_t;
+
+typedef struct {
+	madt_entry_t entry;
+	uint16_t reserved;
+	uint64_t address;
+} __attribute__((packed)) madt_lapic_override_t;
+
+void acpi_init(void);
+acpi_sdt_header_t *acpi_find_table(const char *signature);
+
+#endif /* ACPI_H */
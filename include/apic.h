@@ -0,0 +1,68 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <lib/stdint.h>
+
+#define APIC_MAX_CPUS 8
+#define IOAPIC_MAX 4
+
+#define IA32_APIC_BASE_MSR 0x1B
+#define IA32_APIC_BASE_ENABLE 0x800
+
+// Регистры LAPIC, смещения от базы
+#define LAPIC_ID 0x020
+#define LAPIC_VERSION 0x030
+#define LAPIC_TPR 0x080
+#define LAPIC_EOI 0x0B0
+#define LAPIC_SVR 0x0F0
+#define LAPIC_ESR 0x280
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_LVT_LINT0 0x350
+#define LAPIC_LVT_LINT1 0x360
+#define LAPIC_LVT_ERROR 0x370
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+#define LAPIC_SVR_ENABLE 0x100
+#define LAPIC_ICR_INIT 0x4500
+#define LAPIC_ICR_STARTUP 0x4600
+#define LAPIC_ICR_PENDING 0x1000
+#define LAPIC_LVT_MASKED 0x10000
+#define LAPIC_LVT_NMI 0x400
+#define LAPIC_TIMER_PERIODIC 0x20000
+#define LAPIC_TIMER_DIV16 0x3
+#define LAPIC_CALIBRATE_MS 10
+
+// Регистры IOAPIC
+#define IOAPIC_REGSEL 0x00
+#define IOAPIC_WINDOW 0x10
+#define IOAPIC_VERSION 0x01
+#define IOAPIC_REDIR 0x10
+
+#define IOAPIC_MASKED 0x10000
+#define IOAPIC_LEVEL 0x8000
+#define IOAPIC_ACTIVE_LOW 0x2000
+
+typedef struct {
+	uint32_t address;
+	uint32_t gsi_base;
+	uint32_t pins;
+} ioapic_t;
+
+extern uint32_t apic_cpu_count;
+extern uint8_t apic_cpu_ids[APIC_MAX_CPUS];
+
+int apic_init(void);
+int apic_enabled(void);
+void lapic_enable(void);
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+uint8_t lapic_id(void);
+void lapic_eoi(void);
+void lapic_send_ipi(uint8_t apic_id, uint32_t command);
+void lapic_timer_start(void);
+
+#endif /* APIC_H */
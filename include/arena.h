@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <lib/stddef.h>
+#include <lib/stdint.h>
+
+#define ARENA_ALIGN 8
+#define ARENA_DEFAULT_PAGES 1
+
+typedef struct arena_block {
+	struct arena_block *next;
+	uint32_t pages;
+	uint8_t *ptr;
+	uint8_t *end;
+} arena_block_t;
+
+// Арена принадлежит одной задаче и не защищена блокировкой
+typedef struct arena {
+	arena_block_t first;
+	arena_block_t *current;
+	uint32_t block_pages;
+	size_t allocated;
+} arena_t;
+
+arena_t *arena_create(uint32_t pages);
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_zalloc(arena_t *arena, size_t size);
+void arena_reset(arena_t *arena);
+void arena_destroy(arena_t *arena);
+
+#endif /* ARENA_H */
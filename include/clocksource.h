@@ -0,0 +1,26 @@
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <lib/stdint.h>
+
+#define NSEC_PER_USEC 1000
+#define NSEC_PER_MSEC 1000000
+#define CLOCKSOURCE_SHIFT 22
+#define CLOCKSOURCE_CALIBRATE_MS 50
+
+typedef struct clocksource {
+	const char *name;
+	uint32_t khz;
+	uint32_t mult;
+	uint32_t shift;
+	uint64_t (*read)(void);
+} clocksource_t;
+
+void clocksource_init(void);
+const clocksource_t *clocksource_get(void);
+uint64_t ktime_get_ns(void);
+uint64_t ktime_get_us(void);
+void ndelay(uint32_t nanoseconds);
+void udelay(uint32_t microseconds);
+
+#endif /* CLOCKSOURCE_H */
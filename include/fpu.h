@@ -0,0 +1,30 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <lib/stdint.h>
+#include <task.h>
+
+#define FPU_STATE_SIZE 512
+#define FPU_NO_CPU 0xFFFFFFFF
+#define FPU_MXCSR_DEFAULT 0x1F80
+
+#define CR0_MP 0x00000002
+#define CR0_EM 0x00000004
+#define CR0_TS 0x00000008
+#define CR0_NE 0x00000020
+#define CR4_OSFXSR 0x00000200
+#define CR4_OSXMMEXCPT 0x00000400
+
+// Область FXSAVE; FNSAVE без FXSR занимает её начало
+typedef struct fpu_state {
+	uint8_t data[FPU_STATE_SIZE];
+} __attribute__((aligned(16))) fpu_state_t;
+
+void fpu_init(void);
+void fpu_init_cpu(void);
+void fpu_switch(thread_control_block_t *prev, thread_control_block_t *next);
+void fpu_free(thread_control_block_t *task);
+int fpu_sse_enabled(void);
+void fpu_zero_page(void *page);
+
+#endif /* FPU_H */
@@ -1,23 +1,32 @@
-#ifndef GDT_H
-#define GDT_H
-
-#include <lib/stdint.h>
-
-typedef struct {
-	uint16_t limit_low;
-	uint16_t base_low;
-	uint8_t  base_mid;
-	uint8_t  access;
-	uint8_t  granularity;
-	uint8_t  base_high;
-} __attribute__((packed)) gdt_entry_t;
-
-typedef struct {
-	uint16_t limit;
-	uint32_t base;
-} __attribute__((packed)) gdt_ptr_t;
-
-void gdt_init(void);
-void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
-
+#ifndef GDT_H
+#define GDT_H
+
+#include <lib/stdint.h>
+
+// 0 - null, 1-4 - код и данные ring 0/3, дальше TSS и per-CPU сегмент
+// каждого процессора и TSS обработчика двойного отказа
+#define GDT_MAX_CPUS 8
+#define GDT_TSS_BASE 5
+#define GDT_PERCPU_BASE (GDT_TSS_BASE + GDT_MAX_CPUS)
+#define GDT_DF_TSS (GDT_PERCPU_BASE + GDT_MAX_CPUS)
+#define GDT_ENTRIES (GDT_DF_TSS + 1)
+
+typedef struct {
+	uint16_t limit_low;
+	uint16_t base_low;
+	uint8_t  base_mid;
+	uint8_t  access;
+	uint8_t  granularity;
+	uint8_t  base_high;
+} __attribute__((packed)) gdt_entry_t;
+
+typedef struct {
+	uint16_t limit;
+	uint32_t base;
+} __attribute__((packed)) gdt_ptr_t;
+
+void gdt_init(void);
+void gdt_load(void);
+void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
+
 #endif /* GDT_H */
\ No newline at end of file
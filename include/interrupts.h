@@ -1,28 +1,39 @@
-#ifndef INTERRUPTS_H
-#define INTERRUPTS_H
-
-#include <lib/stdint.h>
-#include <panic.h>
-
-#define IDT_ENTRIES 256
-#define IDT_GATE_INT32 0x8E
-
-typedef struct {
-	uint16_t offset_low;
-	uint16_t selector;
-	uint8_t zero;
-	uint8_t type_attr;
-	uint16_t offset_high;
-} __attribute__((packed)) idt_entry_t;
-
-typedef struct {
-	uint16_t limit;
-	uint32_t base;
-} __attribute__((packed)) idt_ptr_t;
-
-void idt_init(void);
-void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
-extern void irq0(void);
-extern void irq1(void);
-
-#endif /* INTERRUPTS_H */
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <lib/stdint.h>
+#include <panic.h>
+
+#define IDT_ENTRIES 256
+#define IDT_GATE_INT32 0x8E
+#define IDT_GATE_TASK 0x85
+#define IDT_EXCEPTIONS 32
+
+typedef struct {
+	uint16_t offset_low;
+	uint16_t selector;
+	uint8_t zero;
+	uint8_t type_attr;
+	uint16_t offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+typedef struct {
+	uint16_t limit;
+	uint32_t base;
+} __attribute__((packed)) idt_ptr_t;
+
+// Возвращает 1, если исключение обработано и можно вернуться
+typedef int (*isr_handler_t)(registers_t *regs);
+
+void idt_init(void);
+void idt_load(void);
+void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
+void isr_register_handler(uint8_t vector, isr_handler_t handler);
+void isr_dispatch(registers_t *regs);
+extern void irq0(void);
+extern void irq1(void);
+extern void irq_spurious(void);
+extern void ipi_reschedule(void);
+extern void ipi_tlb(void);
+
+#endif /* INTERRUPTS_H */
@@ -0,0 +1,24 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <lib/stdint.h>
+
+#define IRQ_BASE 0x20
+#define IRQ_LINES 16
+#define IRQ_SPURIOUS_VECTOR 0xFF
+
+// Контроллер прерываний: 8259 или IOAPIC + LAPIC
+typedef struct irq_chip {
+	const char *name;
+	void (*mask)(uint8_t irq);
+	void (*unmask)(uint8_t irq);
+	void (*eoi)(uint8_t irq);
+} irq_chip_t;
+
+void irq_set_chip(const irq_chip_t *chip);
+const irq_chip_t *irq_get_chip(void);
+void irq_mask(uint8_t irq);
+void irq_unmask(uint8_t irq);
+void irq_eoi(uint8_t irq);
+
+#endif /* IRQ_H */
@@ -1,10 +1,11 @@
-#ifndef KEYBOARD_H
-#define KEYBOARD_H
-
-#include <lib/stdint.h>
-
-void keyboard_init(void);
-void keyboard_interrupt_handler(void);
-char keyboard_getc(void);
-
-#endif /* KEYBOARD_H */
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <lib/stdint.h>
+
+void keyboard_init(void);
+void keyboard_interrupt_handler(void);
+char keyboard_getc(void);
+char keyboard_trygetc(void);
+
+#endif /* KEYBOARD_H */
@@ -1,22 +1,81 @@
-#ifndef HEAP_H
-#define HEAP_H
-
-#include <lib/stddef.h>
-#include <lib/stdint.h>
-#include <list.h>
-
-#define HEAP_MAGIC 0xDEADBEEF
-
-typedef struct block {
-	uint32_t magic;
-	size_t size;
-	uint8_t free;
-	struct list_head list;
-} block_t;
-
-void heap_init(void);
-void *kmalloc(size_t size);
-void kfree(void *ptr);
-int kwrite(void *ptr, const void *data, size_t size);
-
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <lib/stddef.h>
+#include <lib/stdint.h>
+#include <list.h>
+#include <slab.h>
+#include <pmm.h>
+
+#define HEAP_MAGIC 0xDEADBEEF
+#define HEAP_CHUNK_MAGIC 0xC0FFEE00
+#define HEAP_BINS 20
+#define KHEAP_ZERO_ON_FREE 0
+#define KHEAP_LARGE_MIN PAGE_SIZE
+#define KHEAP_CLASS_BLOCK KMALLOC_CLASSES
+#define KHEAP_CLASS_LARGE (KMALLOC_CLASSES + 1)
+#define KHEAP_CLASSES (KMALLOC_CLASSES + 2)
+#define KHEAP_HIST_BUCKETS 16
+#define KHEAP_TRACK_CALLERS 0
+#define KHEAP_CALLER_SLOTS 32
+
+typedef struct block {
+	uint32_t magic;
+	size_t size;
+	uint32_t free;
+	uint32_t bin;
+} block_t;
+
+typedef struct block_footer {
+	uint32_t magic;
+	size_t size;
+} block_footer_t;
+
+typedef struct heap_chunk {
+	uint32_t magic;
+	uint32_t pages;
+	struct list_head list;
+	block_footer_t prologue;
+} heap_chunk_t;
+
+typedef struct kheap_large {
+	void *addr;
+	uint32_t pages;
+	size_t size;
+	list_head_t list;
+} kheap_large_t;
+
+// За классами слабов идут блочная куча и крупные страничные выделения
+typedef struct {
+	uint32_t allocs[KHEAP_CLASSES];
+	uint32_t frees[KHEAP_CLASSES];
+	uint32_t failed;
+	uint32_t histogram[KHEAP_HIST_BUCKETS];
+	size_t bytes_in_use;
+	size_t peak_bytes;
+	uint32_t pages_held;
+	uint32_t pages_grown;
+	uint32_t pages_returned;
+	uint32_t large_pages;
+	size_t free_bytes;
+	uint32_t free_blocks;
+	size_t largest_free;
+} kheap_stats_t;
+
+typedef struct {
+	void *caller;
+	uint32_t allocs;
+	uint32_t bytes;
+} kheap_caller_t;
+
+void heap_init(void);
+void *kmalloc(size_t size);
+void *kzalloc(size_t size);
+void *kmalloc_aligned(size_t size, size_t align);
+void kfree(void *ptr);
+int kwrite(void *ptr, const void *data, size_t size);
+void kheap_set_zero_on_free(int enable);
+void kheap_get_stats(kheap_stats_t *stats);
+uint32_t kheap_get_callers(const kheap_caller_t **out);
+
 #endif /* HEAP_H */
\ No newline at end of file
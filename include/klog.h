@@ -0,0 +1,46 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include <lib/stdint.h>
+
+#define KLOG_EMERG   0
+#define KLOG_ALERT   1
+#define KLOG_CRIT    2
+#define KLOG_ERR     3
+#define KLOG_WARNING 4
+#define KLOG_NOTICE  5
+#define KLOG_INFO    6
+#define KLOG_DEBUG   7
+
+#define KLOG_DEFAULT_LEVEL KLOG_INFO
+#define KLOG_RECORDS 256
+#define KLOG_MSG_SIZE 116
+#define KLOG_FLUSH_INTERVAL 50
+
+typedef struct klog_record {
+	volatile uint32_t seq;
+	uint32_t ticks;
+	uint8_t level;
+	// Слот занят писателем: от захвата номера до публикации seq
+	volatile uint8_t busy;
+	char text[KLOG_MSG_SIZE];
+} klog_record_t;
+
+extern volatile int klog_level;
+
+// Отфильтрованное сообщение стоит одного сравнения, аргументы не вычисляются
+#define klog(level, ...) \
+	do { \
+		if ((level) <= klog_level) { \
+			klog_write((level), __VA_ARGS__); \
+		} \
+	} while (0)
+
+void klog_write(int level, const char *format, ...);
+void klog_set_level(int level);
+int klog_get_level(void);
+void klog_flush(void);
+void klog_dump(void);
+void klog_task(void);
+
+#endif /* KLOG_H */
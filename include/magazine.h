@@ -0,0 +1,36 @@
+#ifndef MAGAZINE_H
+#define MAGAZINE_H
+
+#include <lib/stdint.h>
+#include <list.h>
+#include <slab.h>
+
+#define MAGAZINE_SIZE 15
+#define MAGAZINE_DEPOT_MAX_FULL 8
+
+typedef struct magazine {
+	list_head_t list;
+	uint32_t rounds;
+	void *objs[MAGAZINE_SIZE];
+} magazine_t;
+
+typedef struct kmem_magazines {
+	magazine_t *loaded[KMALLOC_CLASSES];
+	magazine_t *previous[KMALLOC_CLASSES];
+} kmem_magazines_t;
+
+typedef struct {
+	spinlock_t lock;
+	list_head_t full;
+	list_head_t empty;
+	uint32_t full_count;
+	uint32_t empty_count;
+} magazine_depot_t;
+
+void magazine_init(void);
+kmem_magazines_t *magazine_create(void);
+void magazine_destroy(kmem_magazines_t *mags);
+void *magazine_alloc(kmem_cache_t *cache);
+void magazine_free(kmem_cache_t *cache, void *obj);
+
+#endif /* MAGAZINE_H */
\ No newline at end of file
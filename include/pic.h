@@ -1,16 +1,20 @@
-#ifndef PIC_H
-#define PIC_H
-
-#include <lib/stdint.h>
-
-#define PIC1_CMD 0x20
-#define PIC1_DATA 0x21
-#define PIC2_CMD 0xA0
-#define PIC2_DATA 0xA1
-
-void pic_init(void);
-void pic_mask_irq(uint8_t irq);
-void pic_unmask_irq(uint8_t irq);
-void pic_send_eoi(uint8_t irq);
-
+#ifndef PIC_H
+#define PIC_H
+
+#include <lib/stdint.h>
+#include <irq.h>
+
+#define PIC1_CMD 0x20
+#define PIC1_DATA 0x21
+#define PIC2_CMD 0xA0
+#define PIC2_DATA 0xA1
+
+extern const irq_chip_t pic_chip;
+
+void pic_init(void);
+void pic_disable(void);
+void pic_mask_irq(uint8_t irq);
+void pic_unmask_irq(uint8_t irq);
+void pic_send_eoi(uint8_t irq);
+
 #endif /* PIC_H */
\ No newline at end of file
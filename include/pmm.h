@@ -1,17 +1,57 @@
-#ifndef PMM_H
-#define PMM_H
-
-#include <lib/stdint.h>
-#include <multiboot.h>
-
-#define PAGE_SIZE 4096
-#define PAGE_ALIGN(addr) (((addr) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
-
-void pmm_init(multiboot_info_t *mb_info, uint32_t kernel_end);
-void *pmm_alloc(uint32_t pages);
-void pmm_free(void *addr, uint32_t pages);
-int pmm_is_reserved(void *addr);
-uint32_t pmm_get_total_pages(void);
-uint32_t pmm_get_free_pages(void);
-
+#ifndef PMM_H
+#define PMM_H
+
+#include <lib/stdint.h>
+#include <multiboot.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_ALIGN(addr) (((addr) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+#define PMM_MAX_REGIONS 16
+#define PMM_MAX_ORDER 11
+#define PMM_LOW_LIMIT 0x100000000ULL
+
+#define PMM_ZERO_POOL_SIZE 64
+#define PMM_ZERO_POOL_RESERVE 8
+#define PMM_ZERO_POOL_INTERVAL 100
+
+#define PMM_OWNER_NONE  0
+#define PMM_OWNER_SLAB  1
+#define PMM_OWNER_HEAP  2
+#define PMM_OWNER_LARGE 3
+
+typedef struct {
+	uint64_t base;
+	uint64_t pages;
+} pmm_high_region_t;
+
+typedef struct {
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failed;
+	uint32_t used_pages;
+	uint32_t peak_used_pages;
+	uint32_t free_pages;
+	uint32_t zero_pool_pages;
+	uint32_t largest_free;
+	uint32_t free_blocks[PMM_MAX_ORDER];
+} pmm_stats_t;
+
+void pmm_init(multiboot_info_t *mb_info, uint32_t kernel_end);
+void *pmm_alloc(uint32_t pages);
+void *pmm_alloc_zeroed(uint32_t pages);
+void pmm_free(void *addr, uint32_t pages);
+int pmm_zero_pool_refill(void);
+uint32_t pmm_zero_pool_pages(void);
+void pmm_zero_task(void);
+int pmm_is_reserved(void *addr);
+void pmm_set_owner(void *addr, uint32_t pages, uint8_t owner, void *data);
+uint8_t pmm_get_owner(const void *addr, void **data);
+uint32_t pmm_get_total_pages(void);
+uint64_t pmm_get_max_address(void);
+uint32_t pmm_get_free_pages(void);
+uint64_t pmm_get_high_pages(void);
+uint32_t pmm_get_high_regions(const pmm_high_region_t **out);
+void pmm_get_stats(pmm_stats_t *stats);
+
 #endif /* PMM_H */
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <lib/stddef.h>
+#include <lib/stdint.h>
+#include <list.h>
+#include <spinlock.h>
+
+#define SLAB_CACHE_LINE 64
+#define SLAB_MAGIC 0x51AB51AB
+
+#define KMALLOC_MIN_SIZE 16
+#define KMALLOC_MAX_SIZE 2048
+#define KMALLOC_CLASSES 8
+
+typedef struct kmem_cache {
+	uint32_t magic;
+	spinlock_t lock;
+	char name[24];
+	size_t object_size;
+	size_t size;
+	size_t align;
+	uint32_t slab_pages;
+	uint32_t objects_per_slab;
+	uint32_t offset;
+	list_head_t partial;
+	list_head_t full;
+	list_head_t empty;
+	uint32_t empty_count;
+	uint32_t active_objects;
+	uint32_t total_objects;
+	list_head_t list;
+} kmem_cache_t;
+
+typedef struct slab {
+	kmem_cache_t *cache;
+	list_head_t list;
+	void *free;
+	uint32_t inuse;
+} slab_t;
+
+void slab_init(void);
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align);
+void kmem_cache_destroy(kmem_cache_t *cache);
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+kmem_cache_t *kmalloc_slab(size_t size);
+int kmalloc_index(kmem_cache_t *cache);
+slab_t *slab_of(const void *obj);
+int slab_object_valid(slab_t *slab, const void *obj);
+
+#endif /* SLAB_H */
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <lib/stdint.h>
+#include <lib/stddef.h>
+#include <gdt.h>
+#include <tss.h>
+#include <task.h>
+#include <spinlock.h>
+#include <list.h>
+
+#define SMP_MAX_CPUS GDT_MAX_CPUS
+#define SMP_TRAMPOLINE 0x8000
+#define SMP_AP_STACK_PAGES 4
+#define SMP_AP_TIMEOUT_MS 100
+#define IPI_RESCHEDULE_VECTOR 0xF0
+#define IPI_TLB_VECTOR 0xF1
+
+// Данные процессора; адресуются через %gs, первое поле - указатель на себя
+typedef struct cpu {
+	struct cpu *self;
+	thread_control_block_t *current;
+	thread_control_block_t *idle;
+	tss_entry_t *tss;
+	uint32_t id;
+	uint8_t apic_id;
+	volatile uint8_t online;
+	thread_control_block_t *fpu_owner;
+	// Текущую задачу нужно вытеснить при первой возможности
+	volatile uint8_t need_resched;
+	volatile uint32_t softirq_pending;
+	uint8_t in_softirq;
+	list_head_t tasklets;
+	run_queue_t rq;
+} __attribute__((aligned(64))) cpu_t;
+
+typedef struct {
+	uint32_t stack;
+	uint32_t entry;
+} smp_trampoline_args_t;
+
+extern cpu_t cpus[SMP_MAX_CPUS];
+extern volatile uint32_t smp_cpu_count;
+
+static inline cpu_t *this_cpu(void) {
+	cpu_t *cpu;
+	asm volatile ("movl %%gs:0, %0" : "=r"(cpu));
+	return cpu;
+}
+
+static inline uint32_t smp_processor_id(void) {
+	return this_cpu()->id;
+}
+
+void smp_init_bsp(void);
+void smp_init(void);
+void smp_send_reschedule(cpu_t *cpu);
+void smp_kick_idle(cpu_t *except);
+int smp_others_idle(void);
+void ipi_reschedule_handler(void);
+void smp_tlb_shootdown(uint32_t start, uint32_t pages);
+void ipi_tlb_handler(void);
+
+#endif /* SMP_H */
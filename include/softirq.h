@@ -0,0 +1,37 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <lib/stdint.h>
+#include <list.h>
+
+// Отложенная часть прерываний: выполняется после обработчика с разрешёнными прерываниями
+#define SOFTIRQ_TIMER   0
+#define SOFTIRQ_TASKLET 1
+#define SOFTIRQ_COUNT   2
+
+// Сколько раз подряд перезапускать обработку, если за время работы
+// пришли новые запросы; остаток дождётся следующего прерывания
+#define SOFTIRQ_MAX_RESTART 8
+
+#define TASKLET_SCHEDULED 0x01
+#define TASKLET_RUNNING   0x02
+
+typedef struct tasklet {
+	list_head_t entry;
+	volatile uint32_t state;
+	void (*func)(void *data);
+	void *data;
+} tasklet_t;
+
+void softirq_init(void);
+void open_softirq(uint32_t nr, void (*handler)(void));
+void raise_softirq(uint32_t nr);
+int softirq_pending(void);
+int in_softirq(void);
+void do_softirq(void);
+void irq_exit(void);
+
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *data), void *data);
+void tasklet_schedule(tasklet_t *tasklet);
+
+#endif /* SOFTIRQ_H */
@@ -0,0 +1,162 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <lib/stdint.h>
+#include <lib/stddef.h>
+#include <x86.h>
+
+typedef struct {
+	volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void spin_lock_init(spinlock_t *lock) {
+	lock->locked = 0;
+}
+
+// Ждём чтением, а не xchg, чтобы не гонять строку кэша между CPU
+static inline void spin_lock(spinlock_t *lock) {
+	while (__sync_lock_test_and_set(&lock->locked, 1)) {
+		while (lock->locked) {
+			cpu_relax();
+		}
+	}
+}
+
+static inline int spin_trylock(spinlock_t *lock) {
+	return !__sync_lock_test_and_set(&lock->locked, 1);
+}
+
+static inline void spin_unlock(spinlock_t *lock) {
+	__sync_lock_release(&lock->locked);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t *lock) {
+	uint32_t flags = irq_save();
+	spin_lock(lock);
+	return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags) {
+	spin_unlock(lock);
+	irq_restore(flags);
+}
+
+// Билетная блокировка: захват в порядке прихода, ни один CPU не
+// голодает. Каждый ждущий крутится на общем owner
+typedef union {
+	volatile uint32_t value;
+	struct {
+		volatile uint16_t owner;
+		volatile uint16_t next;
+	};
+} ticket_lock_t;
+
+#define TICKET_LOCK_INIT { 0 }
+
+static inline void ticket_lock_init(ticket_lock_t *lock) {
+	lock->value = 0;
+}
+
+static inline void ticket_lock(ticket_lock_t *lock) {
+	uint16_t ticket = __sync_fetch_and_add(&lock->next, 1);
+	while (lock->owner != ticket) {
+		cpu_relax();
+	}
+	asm volatile ("" : : : "memory");
+}
+
+static inline int ticket_trylock(ticket_lock_t *lock) {
+	uint32_t old = lock->value;
+	if ((old & 0xFFFF) != (old >> 16)) {
+		return 0;
+	}
+	return __sync_bool_compare_and_swap(&lock->value, old, old + 0x10000);
+}
+
+// owner пишет только владелец, атомарная операция не нужна
+static inline void ticket_unlock(ticket_lock_t *lock) {
+	asm volatile ("" : : : "memory");
+	lock->owner = lock->owner + 1;
+}
+
+static inline int ticket_is_contended(ticket_lock_t *lock) {
+	uint32_t value = lock->value;
+	return (uint16_t)((value >> 16) - (value & 0xFFFF)) > 1;
+}
+
+static inline uint32_t ticket_lock_irqsave(ticket_lock_t *lock) {
+	uint32_t flags = irq_save();
+	ticket_lock(lock);
+	return flags;
+}
+
+static inline void ticket_unlock_irqrestore(ticket_lock_t *lock, uint32_t flags) {
+	ticket_unlock(lock);
+	irq_restore(flags);
+}
+
+// MCS: очередь ждущих из узлов на стеке захватывающих, каждый крутится
+// на своём узле, и строка кэша блокировки не гоняется между CPU.
+// Узел нужно передать и в unlock, он живёт до освобождения
+typedef struct mcs_node {
+	struct mcs_node *volatile next;
+	volatile uint32_t locked;
+} mcs_node_t;
+
+typedef struct {
+	mcs_node_t *volatile tail;
+} mcs_lock_t;
+
+#define MCS_LOCK_INIT { NULL }
+
+static inline void mcs_lock_init(mcs_lock_t *lock) {
+	lock->tail = NULL;
+}
+
+static inline void mcs_lock(mcs_lock_t *lock, mcs_node_t *node) {
+	node->next = NULL;
+	node->locked = 1;
+	mcs_node_t *prev = __sync_lock_test_and_set(&lock->tail, node);
+	if (prev) {
+		prev->next = node;
+		while (node->locked) {
+			cpu_relax();
+		}
+	}
+	asm volatile ("" : : : "memory");
+}
+
+static inline int mcs_trylock(mcs_lock_t *lock, mcs_node_t *node) {
+	node->next = NULL;
+	node->locked = 0;
+	return __sync_bool_compare_and_swap(&lock->tail, NULL, node);
+}
+
+static inline void mcs_unlock(mcs_lock_t *lock, mcs_node_t *node) {
+	asm volatile ("" : : : "memory");
+	if (!node->next) {
+		if (__sync_bool_compare_and_swap(&lock->tail, node, NULL)) {
+			return;
+		}
+		// Следующий уже встал в хвост, но ещё не связал себя с нами
+		while (!node->next) {
+			cpu_relax();
+		}
+	}
+	node->next->locked = 0;
+}
+
+static inline uint32_t mcs_lock_irqsave(mcs_lock_t *lock, mcs_node_t *node) {
+	uint32_t flags = irq_save();
+	mcs_lock(lock, node);
+	return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t *lock, mcs_node_t *node, uint32_t flags) {
+	mcs_unlock(lock, node);
+	irq_restore(flags);
+}
+
+#endif /* SPINLOCK_H */
@@ -1,28 +1,52 @@
-#ifndef SYNC_H
-#define SYNC_H
-
-#include <lib/stdint.h>
-#include <list.h>
-#include <task.h>
-
-typedef struct {
-	uint8_t locked;
-	thread_control_block_t *owner;
-	list_head_t wait_list;
-} mutex_t;
-
-typedef struct {
-	uint32_t count;
-	uint32_t max_count;
-	list_head_t wait_list;
-} semaphore_t;
-
-void mutex_init(mutex_t *mutex);
-void mutex_lock(mutex_t *mutex);
-void mutex_unlock(mutex_t *mutex);
-
-void semaphore_init(semaphore_t *sem, uint32_t initial_count, uint32_t max_count);
-void semaphore_wait(semaphore_t *sem);
-void semaphore_signal(semaphore_t *sem);
-
-#endif /* SYNC_H */
\ No newline at end of file
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <lib/stdint.h>
+#include <list.h>
+#include <spinlock.h>
+#include <task.h>
+
+// Сколько итераций ждать занятый мьютекс, пока его владелец работает на другом CPU
+#define MUTEX_SPIN_LIMIT 4096
+// Младшие биты owner: в очереди мьютекса есть ждущие; владелец - не
+// задача, а процессор, ещё не запустивший многозадачность
+#define MUTEX_WAITERS 0x1
+#define MUTEX_CPU     0x2
+#define MUTEX_FLAGS   (MUTEX_WAITERS | MUTEX_CPU)
+
+// Задачи ждут в порядке прихода, узел - wait_list в TCB
+typedef struct wait_queue {
+	spinlock_t lock;
+	list_head_t waiters;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT(name) { SPINLOCK_INIT, LIST_HEAD_INIT((name).waiters) }
+
+typedef struct {
+	volatile uint32_t owner;
+	wait_queue_t wait;
+} mutex_t;
+
+typedef struct {
+	uint32_t count;
+	uint32_t max_count;
+	wait_queue_t wait;
+} semaphore_t;
+
+void wait_queue_init(wait_queue_t *wq);
+void wait_queue_block(wait_queue_t *wq);
+thread_control_block_t *wait_queue_pop(wait_queue_t *wq);
+int wake_up_one(wait_queue_t *wq);
+void wake_up_all(wait_queue_t *wq);
+
+void mutex_init(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+int mutex_trylock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+thread_control_block_t *mutex_owner(mutex_t *mutex);
+
+void semaphore_init(semaphore_t *sem, uint32_t initial_count, uint32_t max_count);
+void semaphore_wait(semaphore_t *sem);
+void semaphore_signal(semaphore_t *sem);
+
+#endif /* SYNC_H */
@@ -1,28 +1,145 @@
-#ifndef TASK_H
-#define TASK_H
-
-#include <lib/stdint.h>
-#include <timer.h>
-
-#define TASK_STATE_RUNNING  0
-#define TASK_STATE_READY    1
-#define TASK_STATE_BLOCKED  2
-
-typedef struct thread_control_block {
-	void* esp;
-	void* esp0;
-	struct thread_control_block* next;
-	uint8_t state;
-	char name[32];
-	timer_t sleep_timer;
-	uint8_t sleeping;
-} thread_control_block_t;
-
-void initialize_multitasking(void);
-void switch_to_task(thread_control_block_t* next_thread);
-thread_control_block_t* create_kernel_task(void (*entry_point)(void), const char* name);
-void schedule(void);
-
-extern thread_control_block_t* current_task_TCB;
-
+#ifndef TASK_H
+#define TASK_H
+
+#include <lib/stdint.h>
+#include <timer.h>
+#include <list.h>
+#include <spinlock.h>
+
+#define TASK_STATE_RUNNING  0
+#define TASK_STATE_READY    1
+#define TASK_STATE_BLOCKED  2
+#define TASK_STATE_DEAD     3
+
+#define TASK_PRIORITIES       32
+#define TASK_PRIORITY_HIGH    8
+#define TASK_PRIORITY_DEFAULT 16
+#define TASK_PRIORITY_LOW     24
+#define TASK_PRIORITY_IDLE    (TASK_PRIORITIES - 1)
+
+#define TASK_STACK_PAGES      4
+#define TASK_STACK_SIZE       (TASK_STACK_PAGES * 4096)
+#define TASK_STACK_CACHE      8
+
+// Без TASK_JOINABLE задача освобождается целиком сразу после выхода;
+// с ним TCB живёт до task_join(), который обязателен и допустим один раз
+#define TASK_JOINABLE         0x01
+
+// Класс EDF стоит выше всех приоритетов обычных задач
+#define TASK_POLICY_NORMAL    0
+#define TASK_POLICY_EDF       1
+
+// Допуск EDF: сумма плотностей runtime/min(deadline, period) на CPU
+// в долях EDF_UTIL_SCALE, часть процессора остаётся обычным задачам
+#define EDF_UTIL_SCALE        1024
+#define EDF_UTIL_MAX          (EDF_UTIL_SCALE * 9 / 10)
+#define EDF_MAX_PERIOD_US     4000000
+
+// Корзина i гистограммы задержки: ожидание в READY меньше 2^i мкс,
+// последняя - всё остальное
+#define TASK_LATENCY_BUCKETS  16
+
+typedef struct task_stats {
+	uint64_t run_ns;
+	uint64_t ready_ns;
+	uint64_t last_run;
+	uint64_t ready_since;
+	uint32_t voluntary;
+	uint32_t involuntary;
+	uint32_t max_latency_us;
+	uint32_t latency[TASK_LATENCY_BUCKETS];
+} task_stats_t;
+
+// Параметры и текущая работа EDF-задачи; времена в наносекундах
+typedef struct task_rt {
+	uint32_t runtime;
+	uint32_t deadline;
+	uint32_t period;
+	uint32_t util;
+	uint64_t release;
+	uint64_t abs_deadline;
+	int64_t budget;
+	uint8_t throttled;
+	uint32_t jobs;
+	uint32_t misses;
+	timer_t timer;
+} task_rt_t;
+
+typedef struct thread_control_block {
+	void* esp;
+	void* esp0;
+	list_head_t list;
+	list_head_t run_list;
+	uint8_t state;
+	uint8_t priority;
+	char name[32];
+	list_head_t sleep_list;
+	uint32_t wake_tick;
+	uint8_t sleeping;
+	// Узел в wait_queue_t (sync.h)
+	list_head_t wait_list;
+	uint32_t cpu;
+	struct kmem_magazines* magazines;
+	void* stack;
+	uint32_t flags;
+	int exit_code;
+	uint8_t reaped;
+	struct thread_control_block* joiner;
+	// Аргумент задачи из create_kernel_task_data
+	void* data;
+	struct fpu_state* fpu;
+	uint32_t fpu_cpu;
+	task_stats_t stats;
+	uint8_t policy;
+	task_rt_t rt;
+} thread_control_block_t;
+
+// Очередь готовых задач процессора: список на каждый приоритет и бит
+// в ready_mask для непустого, 0 - наивысший приоритет. EDF-задачи
+// стоят отдельно по возрастанию срока и закреплены за процессором
+typedef struct run_queue {
+	spinlock_t lock;
+	list_head_t queues[TASK_PRIORITIES];
+	uint32_t ready_mask;
+	list_head_t edf_queue;
+	uint32_t edf_util;
+} run_queue_t;
+
+static inline int run_queue_busy(run_queue_t* rq) {
+	return rq->ready_mask || !list_empty(&rq->edf_queue);
+}
+
+// Смещение поля current в cpu_t (smp.h). Читаем одной инструкцией,
+// чтобы миграция между CPU не вклинилась между двумя загрузками
+#define CPU_CURRENT_OFFSET 4
+
+static inline thread_control_block_t* get_current_task(void) {
+	thread_control_block_t* task;
+	asm volatile ("movl %%gs:%c1, %0" : "=r"(task) : "i"(CPU_CURRENT_OFFSET));
+	return task;
+}
+
+#define current_task_TCB get_current_task()
+
+void initialize_multitasking(void);
+thread_control_block_t* task_create_idle(const char* name, void* esp0);
+void run_queue_init(run_queue_t* rq);
+void switch_to_task(thread_control_block_t* prev, thread_control_block_t* next);
+thread_control_block_t* create_kernel_task(void (*entry_point)(void), const char* name);
+thread_control_block_t* create_kernel_task_flags(void (*entry_point)(void), const char* name, uint32_t flags);
+thread_control_block_t* create_kernel_task_data(void (*entry_point)(void), const char* name, uint32_t flags, void* data);
+void task_exit(int code) __attribute__((noreturn));
+int task_join(thread_control_block_t* task);
+void schedule(void);
+void task_wake(thread_control_block_t* task);
+int task_ready_pending(void);
+void task_set_priority(thread_control_block_t* task, uint8_t priority);
+void task_get_stats(thread_control_block_t* task, task_stats_t* stats);
+int task_set_edf(uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us);
+void task_edf_yield(void);
+void task_tick(void);
+
+extern list_head_t task_list_head;
+extern ticket_lock_t task_list_lock;
+
 #endif /* TASK_H */
\ No newline at end of file
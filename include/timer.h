@@ -1,34 +1,60 @@
-#ifndef TIMER_H
-#define TIMER_H
-
-#include <lib/stdint.h>
-#include <kheap.h>
-
-#define TIMER_FREQ 100
-
-typedef struct {
-	uint32_t expires;
-	void (*callback)(void);
-	uint8_t active;
-	uint8_t periodic;
-	uint32_t interval;
-} timer_t;
-
-typedef struct {
-	volatile uint32_t ticks;
-	uint32_t frequency;
-	uint8_t initialized;
-} system_timer_t;
-
-extern system_timer_t system_timer;
-
-void timer_init(void);
-uint32_t timer_get_ticks(void);
-void timer_create(timer_t *timer, uint32_t milliseconds, void (*callback)(void), uint8_t periodic);
-void timer_update(timer_t *timer);
-void timer_interrupt_handler(void);
-void sleep(uint32_t milliseconds);
-void usleep(uint32_t microseconds);
-void sleep_callback(void);
-
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <lib/stdint.h>
+#include <kheap.h>
+#include <list.h>
+
+#define TIMER_FREQ 100
+
+// Иерархическое колесо: 256 слотов ближнего уровня и 4 уровня по 64
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+
+typedef struct timer {
+	list_head_t entry;
+	uint32_t expires;
+	uint32_t interval;
+	void (*callback)(void *data);
+	void *data;
+} timer_t;
+
+typedef struct {
+	volatile uint32_t ticks;
+	uint32_t frequency;
+	uint8_t initialized;
+} system_timer_t;
+
+// Источник прерываний таймера: периодический режим и однократный
+// с задержкой в тиках, не больше max_ticks
+typedef struct clock_event {
+	const char *name;
+	uint32_t max_ticks;
+	void (*set_periodic)(uint32_t hz);
+	void (*set_oneshot)(uint32_t ticks);
+	uint32_t (*elapsed)(void);
+} clock_event_t;
+
+extern system_timer_t system_timer;
+
+void timer_init(void);
+uint32_t timer_get_ticks(void);
+uint32_t timer_ms_to_ticks(uint32_t milliseconds);
+void timer_setup(timer_t *timer, void (*callback)(void *data), void *data);
+void timer_add(timer_t *timer, uint32_t expires);
+int timer_mod(timer_t *timer, uint32_t expires);
+int timer_cancel(timer_t *timer);
+int timer_cancel_sync(timer_t *timer);
+int timer_pending(const timer_t *timer);
+void timer_interrupt_handler(void);
+void timer_set_clock_event(clock_event_t *event);
+void timer_idle(void);
+void timer_irq_catchup(void);
+void sleep(uint32_t milliseconds);
+void usleep(uint32_t microseconds);
+
 #endif /* TIMER_H */
\ No newline at end of file
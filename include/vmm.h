@@ -0,0 +1,52 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include <lib/stdint.h>
+#include <lib/stddef.h>
+
+#define VMM_LARGE_PAGE_SIZE 0x400000
+#define VMM_ENTRIES 1024
+
+// Биты PDE/PTE
+#define VMM_PRESENT 0x001
+#define VMM_WRITE   0x002
+#define VMM_USER    0x004
+#define VMM_WRITETHROUGH 0x008
+#define VMM_NOCACHE 0x010
+#define VMM_LARGE   0x080
+#define VMM_GLOBAL  0x100
+#define VMM_FRAME_MASK 0xFFFFF000
+
+#define VMM_NOCACHE_FLAGS (VMM_NOCACHE | VMM_WRITETHROUGH)
+
+// Окно ядра для страничных отображений; всё, что ниже, отображено один к одному
+#define VMM_VMALLOC_START 0xE0000000
+#define VMM_VMALLOC_END   0xF0000000
+#define VMM_VMALLOC_PAGES ((VMM_VMALLOC_END - VMM_VMALLOC_START) / 4096)
+
+// Больше страниц дешевле сбросить весь TLB, чем делать invlpg по одной
+#define VMM_FLUSH_ALL_PAGES 32
+
+#define CR0_WP 0x00010000
+#define CR0_PG 0x80000000
+#define CR4_PSE 0x00000010
+#define CR4_PGE 0x00000080
+
+#define PF_PRESENT 0x01
+#define PF_WRITE   0x02
+#define PF_USER    0x04
+#define PF_RESERVED 0x08
+
+void vmm_init(void);
+void vmm_load(void);
+uint32_t vmm_directory(void);
+int vmm_identity_map(uint32_t phys, uint32_t size, uint32_t flags);
+int vmm_map(uint32_t virt, uint32_t phys, uint32_t flags);
+void vmm_unmap(uint32_t virt);
+uint32_t vmm_translate(uint32_t virt);
+void *vmm_alloc(uint32_t pages);
+void vmm_free(void *addr, uint32_t pages);
+int vmm_is_guard(uint32_t virt);
+void vmm_flush_range(uint32_t start, uint32_t pages);
+
+#endif /* VMM_H */
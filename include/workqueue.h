@@ -0,0 +1,31 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <lib/stdint.h>
+#include <list.h>
+#include <spinlock.h>
+#include <task.h>
+
+typedef struct work {
+	list_head_t entry;
+	void (*func)(struct work *work);
+	void *data;
+	volatile uint8_t pending;
+} work_t;
+
+// Очередь работ с собственным потоком ядра; работы выполняются по одной,
+// в контексте задачи, и могут спать
+typedef struct workqueue {
+	char name[24];
+	spinlock_t lock;
+	list_head_t works;
+	thread_control_block_t *worker;
+} workqueue_t;
+
+void workqueue_init(void);
+workqueue_t *workqueue_create(const char *name);
+void work_init(work_t *work, void (*func)(work_t *work), void *data);
+int queue_work(workqueue_t *wq, work_t *work);
+int schedule_work(work_t *work);
+
+#endif /* WORKQUEUE_H */
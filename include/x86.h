@@ -1,42 +1,134 @@
-#ifndef X86_H
-#define X86_H
-
-#include <lib/stdint.h>
-
-static inline uint8_t inb(uint16_t port) {
-	uint8_t ret;
-	asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
-	return ret;
-}
-
-static inline void outb(uint16_t port, uint8_t val) {
-	asm volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
-}
-
-static inline uint16_t inw(uint16_t port) {
-	uint16_t ret;
-	asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
-	return ret;
-}
-
-static inline void outw(uint16_t port, uint16_t val) {
-	asm volatile ("outw %0, %1" : : "a"(val), "Nd"(port));
-}
-
-static inline void cli(void) {
-	asm volatile ("cli");
-}
-
-static inline void sti(void) {
-	asm volatile ("sti");
-}
-
-static inline void hlt(void) {
-	asm volatile ("hlt");
-}
-
-static inline void io_wait(void) {
-	outb(0x80, 0);
-}
-
+#ifndef X86_H
+#define X86_H
+
+#include <lib/stdint.h>
+
+static inline uint8_t inb(uint16_t port) {
+	uint8_t ret;
+	asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+	return ret;
+}
+
+static inline void outb(uint16_t port, uint8_t val) {
+	asm volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port) {
+	uint16_t ret;
+	asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
+	return ret;
+}
+
+static inline void outw(uint16_t port, uint16_t val) {
+	asm volatile ("outw %0, %1" : : "a"(val), "Nd"(port));
+}
+
+// memory: доступы из критической секции не должны переезжать за cli/sti
+static inline void cli(void) {
+	asm volatile ("cli" : : : "memory");
+}
+
+static inline void sti(void) {
+	asm volatile ("sti" : : : "memory");
+}
+
+#define EFLAGS_IF 0x200
+
+static inline uint32_t irq_save(void) {
+	uint32_t flags;
+	asm volatile ("pushf\n"
+		"pop %0\n"
+		"cli" : "=r"(flags) : : "memory");
+	return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+	if (flags & EFLAGS_IF) {
+		sti();
+	}
+}
+
+static inline void hlt(void) {
+	asm volatile ("hlt");
+}
+
+static inline void cpu_relax(void) {
+	asm volatile ("pause" : : : "memory");
+}
+
+static inline uint64_t rdtsc(void) {
+	uint32_t low, high;
+	asm volatile ("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t)high << 32) | low;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx) {
+	asm volatile ("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+	uint32_t low, high;
+	asm volatile ("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+	return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+	asm volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+// 64/32 деление без libgcc
+static inline uint64_t div64_32(uint64_t n, uint32_t base) {
+	uint32_t high = n >> 32;
+	uint32_t low = n;
+	uint32_t rem;
+	uint32_t qhigh = high / base;
+	high %= base;
+	asm ("divl %2" : "=a"(low), "=d"(rem) : "rm"(base), "0"(low), "1"(high));
+	return ((uint64_t)qhigh << 32) | low;
+}
+
+static inline uint32_t read_cr0(void) {
+	uint32_t value;
+	asm volatile ("mov %%cr0, %0" : "=r"(value));
+	return value;
+}
+
+static inline void write_cr0(uint32_t value) {
+	asm volatile ("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr2(void) {
+	uint32_t value;
+	asm volatile ("mov %%cr2, %0" : "=r"(value));
+	return value;
+}
+
+static inline uint32_t read_cr3(void) {
+	uint32_t value;
+	asm volatile ("mov %%cr3, %0" : "=r"(value));
+	return value;
+}
+
+static inline void write_cr3(uint32_t value) {
+	asm volatile ("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+	uint32_t value;
+	asm volatile ("mov %%cr4, %0" : "=r"(value));
+	return value;
+}
+
+static inline void write_cr4(uint32_t value) {
+	asm volatile ("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+static inline void invlpg(uint32_t addr) {
+	asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+static inline void io_wait(void) {
+	outb(0x80, 0);
+}
+
 #endif /* X86_H */
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <acpi.h>
+#include <vmm.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+
+#define BIOS_EBDA_POINTER 0x40E
+#define BIOS_ROM_START 0xE0000
+#define BIOS_ROM_END 0x100000
+
+static acpi_sdt_header_t *rsdt = NULL;
+// Записи XSDT 64-битные, RSDT - 32-битные
+static uint32_t rsdt_entry_size = 4;
+
+static uint8_t acpi_checksum(const void *data, uint32_t length) {
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint8_t sum = 0;
+	for (uint32_t i = 0; i < length; i++) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+// Таблицы могут лежать выше отображённой памяти: сначала заголовок, потом вся длина
+static int acpi_map(const acpi_sdt_header_t *table) {
+	if (vmm_identity_map((uint32_t)table, sizeof(acpi_sdt_header_t), 0) < 0) {
+		return -1;
+	}
+	return vmm_identity_map((uint32_t)table, table->length, 0);
+}
+
+static acpi_rsdp_t *acpi_scan_rsdp(uint32_t start, uint32_t end) {
+	for (uint32_t addr = start; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+		acpi_rsdp_t *rsdp = (acpi_rsdp_t *)addr;
+		if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum(rsdp, 20) == 0) {
+			return rsdp;
+		}
+	}
+	return NULL;
+}
+
+void acpi_init(void) {
+	// Сегмент EBDA из области данных BIOS; читаем через asm, иначе
+	// gcc считает обращение к нулевой странице ошибкой
+	uint32_t ebda;
+	asm volatile ("movzwl (%1), %0" : "=r"(ebda) : "r"(BIOS_EBDA_POINTER));
+	ebda <<= 4;
+	acpi_rsdp_t *rsdp = NULL;
+	if (ebda) {
+		rsdp = acpi_scan_rsdp(ebda, ebda + 1024);
+	}
+	if (!rsdp) {
+		rsdp = acpi_scan_rsdp(BIOS_ROM_START, BIOS_ROM_END);
+	}
+	if (!rsdp) {
+		printf("ACPI: RSDP not found\n");
+		return;
+	}
+
+	if (rsdp->revision >= 2 && rsdp->xsdt_address && !(rsdp->xsdt_address >> 32) &&
+		acpi_checksum(rsdp, rsdp->length) == 0) {
+		rsdt = (acpi_sdt_header_t *)(uint32_t)rsdp->xsdt_address;
+		rsdt_entry_size = 8;
+	} else {
+		rsdt = (acpi_sdt_header_t *)rsdp->rsdt_address;
+		rsdt_entry_size = 4;
+	}
+
+	if (acpi_map(rsdt) < 0 || acpi_checksum(rsdt, rsdt->length) != 0) {
+		printf("ACPI: Invalid %s checksum\n", rsdt_entry_size == 8 ? "XSDT" : "RSDT");
+		rsdt = NULL;
+		return;
+	}
+
+	printf("ACPI: Revision %d, %s at 0x%x\n", rsdp->revision,
+			rsdt_entry_size == 8 ? "XSDT" : "RSDT", (uint32_t)rsdt);
+}
+
+acpi_sdt_header_t *acpi_find_table(const char *signature) {
+	if (!rsdt) {
+		return NULL;
+	}
+
+	uint32_t count = (rsdt->length - sizeof(acpi_sdt_header_t)) / rsdt_entry_size;
+	uint8_t *entries = (uint8_t *)rsdt + sizeof(acpi_sdt_header_t);
+	for (uint32_t i = 0; i < count; i++) {
+		// Старшая половина записи XSDT вне 4 ГБ нам недоступна
+		if (rsdt_entry_size == 8 && *(uint32_t *)(entries + i * 8 + 4)) {
+			continue;
+		}
+		acpi_sdt_header_t *table = (acpi_sdt_header_t *)*(uint32_t *)(entries + i * rsdt_entry_size);
+		if (acpi_map(table) == 0 && memcmp(table->signature, signature, 4) == 0 &&
+			acpi_checksum(table, table->length) == 0) {
+			return table;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,287 @@
+#include <apic.h>
+#include <acpi.h>
+#include <irq.h>
+#include <pic.h>
+#include <timer.h>
+#include <clocksource.h>
+#include <vmm.h>
+#include <pmm.h>
+#include <x86.h>
+#include <lib/stdio.h>
+
+uint32_t apic_cpu_count = 0;
+uint8_t apic_cpu_ids[APIC_MAX_CPUS];
+
+static uint32_t lapic_base = 0;
+static uint8_t bsp_apic_id = 0;
+static ioapic_t ioapics[IOAPIC_MAX];
+static uint32_t ioapic_count = 0;
+
+// ISA IRQ -> GSI с учётом переопределений из MADT
+static uint32_t isa_gsi[IRQ_LINES];
+static uint16_t isa_flags[IRQ_LINES];
+// Копия младших слов перенаправления, чтобы не читать MMIO при маскировании
+static uint32_t isa_redir[IRQ_LINES];
+
+static uint32_t lapic_timer_hz = 0;
+static uint32_t lapic_tick_count = 0;
+static uint32_t lapic_oneshot_count = 0;
+
+uint32_t lapic_read(uint32_t reg) {
+	return *(volatile uint32_t *)(lapic_base + reg);
+}
+
+void lapic_write(uint32_t reg, uint32_t value) {
+	*(volatile uint32_t *)(lapic_base + reg) = value;
+}
+
+uint8_t lapic_id(void) {
+	return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi(void) {
+	lapic_write(LAPIC_EOI, 0);
+}
+
+// command - вектор с режимом доставки в младшем слове ICR
+void lapic_send_ipi(uint8_t apic_id, uint32_t command) {
+	uint32_t flags = irq_save();
+	while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+		cpu_relax();
+	}
+	lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+	lapic_write(LAPIC_ICR_LOW, command);
+	irq_restore(flags);
+}
+
+static uint32_t ioapic_read(ioapic_t *ioapic, uint32_t reg) {
+	*(volatile uint32_t *)(ioapic->address + IOAPIC_REGSEL) = reg;
+	return *(volatile uint32_t *)(ioapic->address + IOAPIC_WINDOW);
+}
+
+static void ioapic_write(ioapic_t *ioapic, uint32_t reg, uint32_t value) {
+	*(volatile uint32_t *)(ioapic->address + IOAPIC_REGSEL) = reg;
+	*(volatile uint32_t *)(ioapic->address + IOAPIC_WINDOW) = value;
+}
+
+static ioapic_t *ioapic_for_gsi(uint32_t gsi) {
+	for (uint32_t i = 0; i < ioapic_count; i++) {
+		if (gsi >= ioapics[i].gsi_base && gsi < ioapics[i].gsi_base + ioapics[i].pins) {
+			return &ioapics[i];
+		}
+	}
+	return NULL;
+}
+
+static void ioapic_set_redir(uint8_t irq) {
+	ioapic_t *ioapic = ioapic_for_gsi(isa_gsi[irq]);
+	if (!ioapic) {
+		return;
+	}
+	uint32_t pin = isa_gsi[irq] - ioapic->gsi_base;
+	ioapic_write(ioapic, IOAPIC_REDIR + pin * 2 + 1, (uint32_t)bsp_apic_id << 24);
+	ioapic_write(ioapic, IOAPIC_REDIR + pin * 2, isa_redir[irq]);
+}
+
+static void apic_mask_irq(uint8_t irq) {
+	isa_redir[irq] |= IOAPIC_MASKED;
+	ioapic_set_redir(irq);
+}
+
+static void apic_unmask_irq(uint8_t irq) {
+	isa_redir[irq] &= ~IOAPIC_MASKED;
+	ioapic_set_redir(irq);
+}
+
+// Для IOAPIC достаточно одной записи в LAPIC: EOI для линий по уровню
+// он рассылает сам
+static void apic_send_eoi(uint8_t irq) {
+	(void)irq;
+	lapic_eoi();
+}
+
+static const irq_chip_t apic_chip = {
+	.name = "ioapic",
+	.mask = apic_mask_irq,
+	.unmask = apic_unmask_irq,
+	.eoi = apic_send_eoi,
+};
+
+// Таймер LAPIC использует вектор IRQ0 и общий обработчик тика
+static void lapic_set_periodic(uint32_t hz) {
+	lapic_tick_count = lapic_timer_hz / hz;
+	lapic_write(LAPIC_LVT_TIMER, IRQ_BASE | LAPIC_TIMER_PERIODIC);
+	lapic_write(LAPIC_TIMER_INITIAL, lapic_tick_count);
+}
+
+static void lapic_set_oneshot(uint32_t ticks) {
+	lapic_oneshot_count = ticks * lapic_tick_count;
+	lapic_write(LAPIC_LVT_TIMER, IRQ_BASE);
+	lapic_write(LAPIC_TIMER_INITIAL, lapic_oneshot_count);
+}
+
+static uint32_t lapic_elapsed(void) {
+	return (lapic_oneshot_count - lapic_read(LAPIC_TIMER_CURRENT)) / lapic_tick_count;
+}
+
+static clock_event_t lapic_clock_event = {
+	.name = "lapic",
+	.max_ticks = 0,
+	.set_periodic = lapic_set_periodic,
+	.set_oneshot = lapic_set_oneshot,
+	.elapsed = lapic_elapsed,
+};
+
+static int madt_parse(acpi_madt_t *madt) {
+	lapic_base = madt->lapic_address;
+	for (int i = 0; i < IRQ_LINES; i++) {
+		isa_gsi[i] = i;
+		isa_flags[i] = 0;
+	}
+
+	uint8_t *pos = (uint8_t *)madt + sizeof(acpi_madt_t);
+	uint8_t *end = (uint8_t *)madt + madt->header.length;
+	while (pos + sizeof(madt_entry_t) <= end) {
+		madt_entry_t *entry = (madt_entry_t *)pos;
+		if (entry->length < sizeof(madt_entry_t)) {
+			break;
+		}
+
+		switch (entry->type) {
+		case MADT_LAPIC: {
+			madt_lapic_t *lapic = (madt_lapic_t *)entry;
+			if ((lapic->flags & MADT_LAPIC_ENABLED) && apic_cpu_count < APIC_MAX_CPUS) {
+				apic_cpu_ids[apic_cpu_count++] = lapic->apic_id;
+			}
+			break;
+		}
+		case MADT_IOAPIC: {
+			madt_ioapic_t *io = (madt_ioapic_t *)entry;
+			if (ioapic_count < IOAPIC_MAX && vmm_identity_map(io->address, PAGE_SIZE, VMM_NOCACHE_FLAGS) == 0) {
+				ioapics[ioapic_count].address = io->address;
+				ioapics[ioapic_count].gsi_base = io->gsi_base;
+				ioapics[ioapic_count].pins = ((ioapic_read(&ioapics[ioapic_count], IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+				ioapic_count++;
+			}
+			break;
+		}
+		case MADT_ISO: {
+			madt_iso_t *iso = (madt_iso_t *)entry;
+			if (iso->bus == 0 && iso->source < IRQ_LINES) {
+				isa_gsi[iso->source] = iso->gsi;
+				isa_flags[iso->source] = iso->flags;
+			}
+			break;
+		}
+		case MADT_LAPIC_OVERRIDE: {
+			madt_lapic_override_t *override = (madt_lapic_override_t *)entry;
+			if (!(override->address >> 32)) {
+				lapic_base = (uint32_t)override->address;
+			}
+			break;
+		}
+		}
+		pos += entry->length;
+	}
+
+	return apic_cpu_count && ioapic_count ? 0 : -1;
+}
+
+// Настройка LAPIC текущего процессора
+void lapic_enable(void) {
+	wrmsr(IA32_APIC_BASE_MSR, rdmsr(IA32_APIC_BASE_MSR) | IA32_APIC_BASE_ENABLE);
+	lapic_write(LAPIC_TPR, 0);
+	lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+	lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_ESR, 0);
+	lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | IRQ_SPURIOUS_VECTOR);
+	lapic_eoi();
+}
+
+// Считаем такты таймера LAPIC за интервал, отмеренный по TSC
+static int lapic_timer_calibrate(void) {
+	if (!clocksource_get()) {
+		return -1;
+	}
+
+	lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV16);
+	lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+	udelay(LAPIC_CALIBRATE_MS * 1000);
+	uint32_t count = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+	lapic_write(LAPIC_TIMER_INITIAL, 0);
+
+	lapic_timer_hz = count * (1000 / LAPIC_CALIBRATE_MS);
+	lapic_tick_count = lapic_timer_hz / system_timer.frequency;
+	if (!lapic_tick_count) {
+		return -1;
+	}
+
+	uint32_t max_ticks = 0xFFFFFFFF / lapic_tick_count;
+	lapic_clock_event.max_ticks = max_ticks < TVR_SIZE ? max_ticks : TVR_SIZE;
+	return 0;
+}
+
+// Периодический тик на AP с частотой, откалиброванной на BSP
+void lapic_timer_start(void) {
+	if (!lapic_timer_hz) {
+		return;
+	}
+	lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV16);
+	lapic_set_periodic(system_timer.frequency);
+}
+
+int apic_enabled(void) {
+	return lapic_base != 0 && irq_get_chip() == &apic_chip;
+}
+
+int apic_init(void) {
+	uint32_t eax, ebx, ecx, edx;
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	if (!(edx & (1 << 9))) {
+		printf("APIC: No local APIC, using 8259\n");
+		return -1;
+	}
+
+	acpi_init();
+	acpi_madt_t *madt = (acpi_madt_t *)acpi_find_table("APIC");
+	if (!madt || madt_parse(madt) < 0 || vmm_identity_map(lapic_base, PAGE_SIZE, VMM_NOCACHE_FLAGS) < 0) {
+		printf("APIC: No usable MADT, using 8259\n");
+		lapic_base = 0;
+		return -1;
+	}
+
+	uint32_t flags = irq_save();
+	lapic_enable();
+	bsp_apic_id = lapic_id();
+
+	for (uint8_t irq = 0; irq < IRQ_LINES; irq++) {
+		uint32_t redir = IOAPIC_MASKED | (IRQ_BASE + irq);
+		if ((isa_flags[irq] & MADT_POLARITY_LOW) == MADT_POLARITY_LOW) {
+			redir |= IOAPIC_ACTIVE_LOW;
+		}
+		if ((isa_flags[irq] & MADT_TRIGGER_LEVEL) == MADT_TRIGGER_LEVEL) {
+			redir |= IOAPIC_LEVEL;
+		}
+		isa_redir[irq] = redir;
+		ioapic_set_redir(irq);
+	}
+
+	irq_set_chip(&apic_chip);
+	pic_disable();
+
+	if (lapic_timer_calibrate() == 0) {
+		// PIT больше не нужен: тик идёт от LAPIC
+		irq_mask(0);
+		timer_set_clock_event(&lapic_clock_event);
+		printf("APIC: LAPIC timer at %d kHz\n", lapic_timer_hz / 1000);
+	} else {
+		printf("APIC: LAPIC timer not calibrated, keeping PIT tick\n");
+	}
+	irq_restore(flags);
+
+	printf("APIC: LAPIC at 0x%x, %d CPU(s), %d IOAPIC(s)\n", lapic_base, apic_cpu_count, ioapic_count);
+	return 0;
+}
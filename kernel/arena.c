@@ -0,0 +1,99 @@
+#include <arena.h>
+#include <pmm.h>
+#include <klog.h>
+#include <lib/string.h>
+
+static void arena_block_init(arena_block_t *block, uint32_t pages, void *data) {
+	block->next = NULL;
+	block->pages = pages;
+	block->ptr = (uint8_t *)(((uint32_t)data + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+	block->end = (uint8_t *)block + pages * PAGE_SIZE;
+}
+
+static arena_block_t *arena_grow(arena_t *arena, size_t size) {
+	uint32_t pages = (sizeof(arena_block_t) + ARENA_ALIGN + size + PAGE_SIZE - 1) / PAGE_SIZE;
+	if (pages < arena->block_pages) {
+		pages = arena->block_pages;
+	}
+
+	arena_block_t *block = (arena_block_t *)pmm_alloc(pages);
+	if (!block) {
+		klog(KLOG_ERR, "Arena: Out of memory for %d bytes\n", size);
+		return NULL;
+	}
+	arena_block_init(block, pages, block + 1);
+	arena->current->next = block;
+	arena->current = block;
+	return block;
+}
+
+arena_t *arena_create(uint32_t pages) {
+	if (pages == 0) {
+		pages = ARENA_DEFAULT_PAGES;
+	}
+
+	arena_t *arena = (arena_t *)pmm_alloc(pages);
+	if (!arena) {
+		klog(KLOG_ERR, "Arena: Failed to create arena of %d pages\n", pages);
+		return NULL;
+	}
+	arena_block_init(&arena->first, pages, arena + 1);
+	arena->current = &arena->first;
+	arena->block_pages = pages;
+	arena->allocated = 0;
+	return arena;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+	if (!arena || size == 0) {
+		return NULL;
+	}
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	arena_block_t *block = arena->current;
+	if ((size_t)(block->end - block->ptr) < size) {
+		block = arena_grow(arena, size);
+		if (!block) {
+			return NULL;
+		}
+	}
+
+	void *ptr = block->ptr;
+	block->ptr += size;
+	arena->allocated += size;
+	return ptr;
+}
+
+void *arena_zalloc(arena_t *arena, size_t size) {
+	void *ptr = arena_alloc(arena, size);
+	if (ptr) {
+		memset(ptr, 0, size);
+	}
+	return ptr;
+}
+
+// Первый блок остаётся, дополнительные возвращаются в PMM
+void arena_reset(arena_t *arena) {
+	if (!arena) {
+		return;
+	}
+
+	arena_block_t *block = arena->first.next;
+	while (block) {
+		arena_block_t *next = block->next;
+		pmm_free(block, block->pages);
+		block = next;
+	}
+	arena_block_init(&arena->first, arena->first.pages, arena + 1);
+	arena->current = &arena->first;
+	arena->allocated = 0;
+}
+
+void arena_destroy(arena_t *arena) {
+	if (!arena) {
+		return;
+	}
+
+	arena_reset(arena);
+	pmm_free(arena, arena->first.pages);
+}
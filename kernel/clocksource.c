@@ -0,0 +1,139 @@
+#include <clocksource.h>
+#include <timer.h>
+#include <x86.h>
+#include <spinlock.h>
+#include <lib/stdio.h>
+
+#define PIT_FREQ 1193180
+#define PIT_CMD_PORT 0x43
+#define PIT_CHANNEL2_DATA 0x42
+#define SPEAKER_PORT 0x61
+
+static uint64_t tsc_read(void) {
+	return rdtsc();
+}
+
+static clocksource_t tsc_clocksource = {
+	.name = "tsc",
+	.khz = 0,
+	.mult = 0,
+	.shift = CLOCKSOURCE_SHIFT,
+	.read = tsc_read,
+};
+
+static clocksource_t *clocksource = NULL;
+static uint64_t boot_cycles = 0;
+// Обратный множитель: наносекунды -> такты
+static uint32_t ns2cyc_mult = 0;
+
+static inline uint64_t mul_u64_u32_shr(uint64_t value, uint32_t mult, uint32_t shift) {
+	uint32_t high = value >> 32;
+	uint64_t result = ((uint64_t)(uint32_t)value * mult) >> shift;
+	if (high) {
+		result += ((uint64_t)high * mult) << (32 - shift);
+	}
+	return result;
+}
+
+static int tsc_available(void) {
+	uint32_t eax, ebx, ecx, edx;
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	return (edx >> 4) & 1;
+}
+
+#define PIT_MAX_COUNT 0xFFFF
+
+// Канал 2 занимают калибровка и задержки без TSC
+static spinlock_t pit2_lock = SPINLOCK_INIT;
+
+// Канал 2 PIT в режиме 0 с открытым затвором и выключенным динамиком:
+// OUT2 (бит 5 порта 0x61) поднимается по окончании счёта. Не зависит
+// от прерываний, поэтому годится и при запрещённых
+static void pit2_wait(uint32_t count) {
+	uint8_t port = inb(SPEAKER_PORT);
+	outb(SPEAKER_PORT, (port & ~0x02) | 0x01);
+	outb(PIT_CMD_PORT, 0xB0);
+	outb(PIT_CHANNEL2_DATA, count & 0xFF);
+	outb(PIT_CHANNEL2_DATA, (count >> 8) & 0xFF);
+
+	while (!(inb(SPEAKER_PORT) & 0x20)) {
+		cpu_relax();
+	}
+	outb(SPEAKER_PORT, port);
+}
+
+static uint32_t tsc_calibrate_khz(void) {
+	uint32_t flags = spin_lock_irqsave(&pit2_lock);
+	uint64_t start = rdtsc();
+	pit2_wait(PIT_FREQ / (1000 / CLOCKSOURCE_CALIBRATE_MS));
+	uint64_t end = rdtsc();
+	spin_unlock_irqrestore(&pit2_lock, flags);
+
+	return (uint32_t)div64_32(end - start, CLOCKSOURCE_CALIBRATE_MS);
+}
+
+void clocksource_init(void) {
+	if (!tsc_available()) {
+		printf("Clocksource: No TSC, falling back to timer ticks\n");
+		return;
+	}
+
+	uint32_t khz = tsc_calibrate_khz();
+	if (khz == 0) {
+		printf("Clocksource: TSC calibration failed, falling back to timer ticks\n");
+		return;
+	}
+
+	tsc_clocksource.khz = khz;
+	tsc_clocksource.mult = (uint32_t)div64_32((uint64_t)NSEC_PER_MSEC << CLOCKSOURCE_SHIFT, khz);
+	ns2cyc_mult = (uint32_t)div64_32((uint64_t)khz << CLOCKSOURCE_SHIFT, NSEC_PER_MSEC);
+	boot_cycles = tsc_clocksource.read();
+	clocksource = &tsc_clocksource;
+
+	printf("Clocksource: TSC calibrated at %d.%03d MHz\n", khz / 1000, khz % 1000);
+}
+
+const clocksource_t *clocksource_get(void) {
+	return clocksource;
+}
+
+uint64_t ktime_get_ns(void) {
+	if (!clocksource) {
+		return (uint64_t)system_timer.ticks * (1000000000 / TIMER_FREQ);
+	}
+	return mul_u64_u32_shr(clocksource->read() - boot_cycles, clocksource->mult, clocksource->shift);
+}
+
+uint64_t ktime_get_us(void) {
+	return div64_32(ktime_get_ns(), NSEC_PER_USEC);
+}
+
+void ndelay(uint32_t nanoseconds) {
+	if (!clocksource) {
+		// Без TSC отсчитываем каналом 2 PIT: тики не идут, если
+		// прерывания запрещены, а udelay зовут и так
+		uint32_t count = (uint32_t)div64_32((uint64_t)nanoseconds * PIT_FREQ, 1000000000) + 1;
+		while (count) {
+			uint32_t step = count > PIT_MAX_COUNT ? PIT_MAX_COUNT : count;
+			uint32_t flags = spin_lock_irqsave(&pit2_lock);
+			pit2_wait(step);
+			spin_unlock_irqrestore(&pit2_lock, flags);
+			count -= step;
+		}
+		return;
+	}
+
+	uint64_t cycles = mul_u64_u32_shr(nanoseconds, ns2cyc_mult, CLOCKSOURCE_SHIFT);
+	uint64_t start = clocksource->read();
+	while (clocksource->read() - start < cycles) {
+		cpu_relax();
+	}
+}
+
+void udelay(uint32_t microseconds) {
+	while (microseconds > 1000000) {
+		ndelay(1000000000);
+		microseconds -= 1000000;
+	}
+	ndelay(microseconds * NSEC_PER_USEC);
+}
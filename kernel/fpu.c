@@ -0,0 +1,176 @@
+#include <fpu.h>
+#include <smp.h>
+#include <slab.h>
+#include <pmm.h>
+#include <interrupts.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+
+static kmem_cache_t *fpu_cache = NULL;
+static fpu_state_t fpu_initial_state;
+static uint32_t fpu_fxsr = 0;
+static uint32_t fpu_sse = 0;
+static uint32_t fpu_ready = 0;
+
+static inline void clts(void) {
+	asm volatile ("clts");
+}
+
+static inline void stts(void) {
+	uint32_t cr0 = read_cr0();
+	if (!(cr0 & CR0_TS)) {
+		write_cr0(cr0 | CR0_TS);
+	}
+}
+
+static inline void fpu_save(fpu_state_t *state) {
+	if (fpu_fxsr) {
+		asm volatile ("fxsave (%0)" : : "r"(state) : "memory");
+	} else {
+		asm volatile ("fnsave (%0)\n"
+			"fwait" : : "r"(state) : "memory");
+	}
+}
+
+static inline void fpu_restore(fpu_state_t *state) {
+	if (fpu_fxsr) {
+		asm volatile ("fxrstor (%0)" : : "r"(state) : "memory");
+	} else {
+		asm volatile ("frstor (%0)" : : "r"(state) : "memory");
+	}
+}
+
+// #NM: задача впервые в этом кванте тронула FPU. Прежний владелец уже
+// сохранён при переключении, остаётся загрузить состояние текущей
+static int fpu_trap(registers_t *regs) {
+	(void)regs;
+	thread_control_block_t *task = current_task_TCB;
+	if (!fpu_ready || !task) {
+		return 0;
+	}
+
+	cpu_t *cpu = this_cpu();
+	clts();
+	if (cpu->fpu_owner == task && task->fpu_cpu == cpu->id) {
+		return 1;
+	}
+
+	if (!task->fpu) {
+		task->fpu = (fpu_state_t *)kmem_cache_alloc(fpu_cache);
+		if (!task->fpu) {
+			printf("FPU: No memory for state of task '%s'\n", task->name);
+			return 0;
+		}
+		memcpy(task->fpu, &fpu_initial_state, sizeof(fpu_state_t));
+	}
+
+	fpu_restore(task->fpu);
+	cpu->fpu_owner = task;
+	task->fpu_cpu = cpu->id;
+	return 1;
+}
+
+void fpu_init_cpu(void) {
+	write_cr0((read_cr0() & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+	if (fpu_fxsr) {
+		write_cr4(read_cr4() | CR4_OSFXSR | (fpu_sse ? CR4_OSXMMEXCPT : 0));
+	}
+}
+
+void fpu_init(void) {
+	uint32_t eax, ebx, ecx, edx;
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	if (!(edx & (1 << 0))) {
+		printf("FPU: No x87 unit, FPU disabled\n");
+		return;
+	}
+	fpu_fxsr = (edx >> 24) & 1;
+	fpu_sse = fpu_fxsr && ((edx >> 25) & 1);
+
+	fpu_cache = kmem_cache_create("fpu_state", sizeof(fpu_state_t), 16);
+	if (!fpu_cache) {
+		printf("FPU: Failed to create state cache, FPU disabled\n");
+		return;
+	}
+
+	fpu_init_cpu();
+
+	// Чистое состояние, с которого начинает каждая задача
+	clts();
+	asm volatile ("fninit");
+	if (fpu_sse) {
+		uint32_t mxcsr = FPU_MXCSR_DEFAULT;
+		asm volatile ("ldmxcsr %0" : : "m"(mxcsr));
+	}
+	fpu_save(&fpu_initial_state);
+	stts();
+
+	isr_register_handler(7, fpu_trap);
+	fpu_ready = 1;
+
+	printf("FPU: Lazy %s switching%s\n", fpu_fxsr ? "FXSAVE" : "FNSAVE", fpu_sse ? ", SSE enabled" : "");
+}
+
+// Вызывается из schedule() с захваченной очередью. Снятый TS означает,
+// что prev работал с FPU в этом кванте: сохраняем сразу, пока его не
+// забрал другой процессор. Регистры при этом остаются его, и если next -
+// их владелец, #NM не нужен
+void fpu_switch(thread_control_block_t *prev, thread_control_block_t *next) {
+	if (!fpu_ready) {
+		return;
+	}
+
+	cpu_t *cpu = this_cpu();
+	if (!(read_cr0() & CR0_TS)) {
+		fpu_save(prev->fpu);
+		if (!fpu_fxsr) {
+			// FNSAVE сбрасывает регистры
+			cpu->fpu_owner = NULL;
+		}
+	}
+
+	if (cpu->fpu_owner == next && next->fpu_cpu == cpu->id) {
+		clts();
+	} else {
+		stts();
+	}
+}
+
+// Задача сошла с процессора навсегда: забываем её регистры на всех CPU
+void fpu_free(thread_control_block_t *task) {
+	for (uint32_t i = 0; i < smp_cpu_count; i++) {
+		__sync_bool_compare_and_swap(&cpus[i].fpu_owner, task, NULL);
+	}
+	if (task->fpu) {
+		kmem_cache_free(fpu_cache, task->fpu);
+		task->fpu = NULL;
+	}
+	task->fpu_cpu = FPU_NO_CPU;
+}
+
+int fpu_sse_enabled(void) {
+	return fpu_ready && fpu_sse;
+}
+
+// Обнуление страницы мимо кэша. Только из контекста задачи: состояние
+// SSE принадлежит текущей задаче, в обработчиках прерываний его трогать нельзя
+void fpu_zero_page(void *page) {
+	uint8_t *pos = (uint8_t *)page;
+	uint8_t *end = pos + PAGE_SIZE;
+	asm volatile (
+		"xorps %%xmm0, %%xmm0\n"
+		"1:\n"
+		"movntps %%xmm0, 0(%0)\n"
+		"movntps %%xmm0, 16(%0)\n"
+		"movntps %%xmm0, 32(%0)\n"
+		"movntps %%xmm0, 48(%0)\n"
+		"add $64, %0\n"
+		"cmp %1, %0\n"
+		"jne 1b\n"
+		"sfence\n"
+		: "+r"(pos)
+		: "r"(end)
+		: "memory", "cc"
+	);
+}
@@ -0,0 +1,45 @@
+#include <irq.h>
+#include <pic.h>
+#include <x86.h>
+#include <spinlock.h>
+#include <lib/stdio.h>
+
+static const irq_chip_t *irq_chip = &pic_chip;
+// Разрешённые линии, чтобы перенести их на новый контроллер
+static uint16_t irq_enabled = 0;
+static spinlock_t irq_lock = SPINLOCK_INIT;
+
+void irq_set_chip(const irq_chip_t *chip) {
+	uint32_t flags = spin_lock_irqsave(&irq_lock);
+	for (uint8_t irq = 0; irq < IRQ_LINES; irq++) {
+		if (irq_enabled & (1 << irq)) {
+			irq_chip->mask(irq);
+			chip->unmask(irq);
+		}
+	}
+	irq_chip = chip;
+	spin_unlock_irqrestore(&irq_lock, flags);
+	printf("IRQ: Using interrupt controller '%s'\n", chip->name);
+}
+
+const irq_chip_t *irq_get_chip(void) {
+	return irq_chip;
+}
+
+void irq_mask(uint8_t irq) {
+	uint32_t flags = spin_lock_irqsave(&irq_lock);
+	irq_enabled &= ~(1 << irq);
+	irq_chip->mask(irq);
+	spin_unlock_irqrestore(&irq_lock, flags);
+}
+
+void irq_unmask(uint8_t irq) {
+	uint32_t flags = spin_lock_irqsave(&irq_lock);
+	irq_enabled |= 1 << irq;
+	irq_chip->unmask(irq);
+	spin_unlock_irqrestore(&irq_lock, flags);
+}
+
+void irq_eoi(uint8_t irq) {
+	irq_chip->eoi(irq);
+}
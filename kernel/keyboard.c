@@ -1,133 +1,185 @@
-#include <keyboard.h>
-#include <lib/stdio.h>
-#include <x86.h>
-#include <pic.h>
-#include <kheap.h>
-#include <panic.h>
-#include <task.h>
-#include <sync.h>
-
-static const char scancode_to_char[] = {
-	0,  0,  '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b', '\t',
-	'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0,   'a', 's',
-	'd', 'f', 'g', 'h', 'j', 'k', 'l', ';', '\'', '`', 0,   '\\', 'z', 'x', 'c', 'v',
-	'b', 'n', 'm', ',', '.', '/', 0,   '*', 0,   ' ', 0,   0,   0,   0,   0,   0,
-	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
-};
-
-static const char scancode_to_char_shift[] = {
-	0,  0,  '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+', '\b', '\t',
-	'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n', 0,   'A', 'S',
-	'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~', 0,   '|', 'Z', 'X', 'C', 'V',
-	'B', 'N', 'M', '<', '>', '?', 0,   '*', 0,   ' ', 0,   0,   0,   0,   0,   0,
-	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
-};
-
-#define KEY_BUFFER_SIZE 256
-static char *key_buffer;
-static uint32_t key_buffer_head = 0;
-static uint32_t key_buffer_tail = 0;
-static uint32_t key_buffer_count = 0;
-static mutex_t key_mutex;
-static volatile uint8_t shift_pressed = 0;
-static volatile uint8_t caps_lock_active = 0;
-
-static void key_buffer_push(char c) {
-	mutex_lock(&key_mutex);
-	if (key_buffer_count < KEY_BUFFER_SIZE) {
-		key_buffer[key_buffer_head] = c;
-		key_buffer_head = (key_buffer_head + 1) % KEY_BUFFER_SIZE;
-		key_buffer_count++;
-	}
-	mutex_unlock(&key_mutex);
-}
-
-static char key_buffer_pop(void) {
-	mutex_lock(&key_mutex);
-	if (key_buffer_count == 0) {
-		mutex_unlock(&key_mutex);
-		return 0;
-	}
-	char c = key_buffer[key_buffer_tail];
-	key_buffer_tail = (key_buffer_tail + 1) % KEY_BUFFER_SIZE;
-	key_buffer_count--;
-	mutex_unlock(&key_mutex);
-	return c;
-}
-
-static inline int is_letter(char c) {
-	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
-}
-
-void keyboard_interrupt_handler(void) {
-	uint8_t scancode = inb(0x60);
-	uint8_t released = scancode & 0x80;
-	scancode &= 0x7F;
-
-	if (scancode >= sizeof(scancode_to_char) / sizeof(scancode_to_char[0])) {
-		pic_send_eoi(1);
-		return;
-	}
-
-	if (scancode == 0x2A || scancode == 0x36) {
-		shift_pressed = released ? 0 : 1;
-		pic_send_eoi(1);
-		return;
-    }
-
-	if (scancode == 0x3A && !released) {
-		caps_lock_active = !caps_lock_active;
-		pic_send_eoi(1);
-		return;
-	}
-
-	if (released) {
-		pic_send_eoi(1);
-		return;
-	}
-
-	char c = scancode_to_char[scancode];
-	if (c != 0) {
-		if (is_letter(c)) {
-			if (caps_lock_active && !shift_pressed) {
-				c = scancode_to_char_shift[scancode];
-			} else if (!caps_lock_active && shift_pressed) {
-				c = scancode_to_char_shift[scancode];
-			} else if (caps_lock_active && shift_pressed) {
-				c = scancode_to_char[scancode];
-			}
-		} else {
-			if (shift_pressed) {
-				c = scancode_to_char_shift[scancode];
-			}
-		}
-		key_buffer_push(c);
-	}
-
-	pic_send_eoi(1);
-}
-
-void keyboard_init(void) {
-	key_buffer = kmalloc(KEY_BUFFER_SIZE);
-	if (!key_buffer) {
-		panic_custom("Failed to allocate keyboard buffer");
-	}
-
-	key_buffer_head = 0;
-	key_buffer_tail = 0;
-	key_buffer_count = 0;
-	shift_pressed = 0;
-	caps_lock_active = 0;
-
-	mutex_init(&key_mutex);
-	pic_unmask_irq(1);
-}
-
-char keyboard_getc(void) {
-	while (key_buffer_count == 0) {
-		schedule();
-	}
-	return key_buffer_pop();
-}
\ No newline at end of file
+#include <keyboard.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <irq.h>
+#include <kheap.h>
+#include <panic.h>
+#include <task.h>
+#include <spinlock.h>
+#include <softirq.h>
+
+static const char scancode_to_char[] = {
+	0,  0,  '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b', '\t',
+	'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0,   'a', 's',
+	'd', 'f', 'g', 'h', 'j', 'k', 'l', ';', '\'', '`', 0,   '\\', 'z', 'x', 'c', 'v',
+	'b', 'n', 'm', ',', '.', '/', 0,   '*', 0,   ' ', 0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+static const char scancode_to_char_shift[] = {
+	0,  0,  '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+', '\b', '\t',
+	'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n', 0,   'A', 'S',
+	'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~', 0,   '|', 'Z', 'X', 'C', 'V',
+	'B', 'N', 'M', '<', '>', '?', 0,   '*', 0,   ' ', 0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+#define KEY_BUFFER_SIZE 256
+static char *key_buffer;
+static uint32_t key_buffer_head = 0;
+static uint32_t key_buffer_tail = 0;
+static uint32_t key_buffer_count = 0;
+// Буфер символов и ожидающая задача; пишет в буфер тасклет
+static ticket_lock_t key_lock = TICKET_LOCK_INIT;
+static thread_control_block_t *key_waiter = NULL;
+static volatile uint8_t shift_pressed = 0;
+static volatile uint8_t caps_lock_active = 0;
+
+// Сырые скан-коды от прерывания до тасклета: один писатель, один читатель
+#define SCANCODE_RING_SIZE 64
+static volatile uint8_t scancode_ring[SCANCODE_RING_SIZE];
+static volatile uint32_t scancode_head = 0;
+static volatile uint32_t scancode_tail = 0;
+static tasklet_t keyboard_tasklet;
+
+static char key_buffer_pop_locked(void) {
+	if (key_buffer_count == 0) {
+		return 0;
+	}
+	char c = key_buffer[key_buffer_tail];
+	key_buffer_tail = (key_buffer_tail + 1) % KEY_BUFFER_SIZE;
+	key_buffer_count--;
+	return c;
+}
+
+static void key_buffer_push(char c) {
+	uint32_t flags = ticket_lock_irqsave(&key_lock);
+	if (key_buffer_count < KEY_BUFFER_SIZE) {
+		key_buffer[key_buffer_head] = c;
+		key_buffer_head = (key_buffer_head + 1) % KEY_BUFFER_SIZE;
+		key_buffer_count++;
+	}
+	thread_control_block_t *waiter = key_waiter;
+	key_waiter = NULL;
+	ticket_unlock_irqrestore(&key_lock, flags);
+
+	if (waiter) {
+		task_wake(waiter);
+	}
+}
+
+static inline int is_letter(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static void keyboard_decode(uint8_t scancode) {
+	uint8_t released = scancode & 0x80;
+	scancode &= 0x7F;
+
+	if (scancode >= sizeof(scancode_to_char) / sizeof(scancode_to_char[0])) {
+		return;
+	}
+
+	if (scancode == 0x2A || scancode == 0x36) {
+		shift_pressed = released ? 0 : 1;
+		return;
+	}
+
+	if (scancode == 0x3A && !released) {
+		caps_lock_active = !caps_lock_active;
+		return;
+	}
+
+	if (released) {
+		return;
+	}
+
+	char c = scancode_to_char[scancode];
+	if (c != 0) {
+		if (is_letter(c)) {
+			if (caps_lock_active && !shift_pressed) {
+				c = scancode_to_char_shift[scancode];
+			} else if (!caps_lock_active && shift_pressed) {
+				c = scancode_to_char_shift[scancode];
+			} else if (caps_lock_active && shift_pressed) {
+				c = scancode_to_char[scancode];
+			}
+		} else {
+			if (shift_pressed) {
+				c = scancode_to_char_shift[scancode];
+			}
+		}
+		key_buffer_push(c);
+	}
+}
+
+static void keyboard_tasklet_func(void *data) {
+	(void)data;
+	while (scancode_tail != scancode_head) {
+		uint8_t scancode = scancode_ring[scancode_tail % SCANCODE_RING_SIZE];
+		__sync_synchronize();
+		scancode_tail++;
+		keyboard_decode(scancode);
+	}
+}
+
+// Только забираем скан-код у контроллера; разбор - в тасклете
+void keyboard_interrupt_handler(void) {
+	uint8_t scancode = inb(0x60);
+	if (scancode_head - scancode_tail < SCANCODE_RING_SIZE) {
+		scancode_ring[scancode_head % SCANCODE_RING_SIZE] = scancode;
+		__sync_synchronize();
+		scancode_head++;
+	}
+	irq_eoi(1);
+
+	tasklet_schedule(&keyboard_tasklet);
+	irq_exit();
+}
+
+void keyboard_init(void) {
+	key_buffer = kmalloc(KEY_BUFFER_SIZE);
+	if (!key_buffer) {
+		panic_custom("Failed to allocate keyboard buffer");
+	}
+
+	key_buffer_head = 0;
+	key_buffer_tail = 0;
+	key_buffer_count = 0;
+	shift_pressed = 0;
+	caps_lock_active = 0;
+
+	scancode_head = 0;
+	scancode_tail = 0;
+	tasklet_init(&keyboard_tasklet, keyboard_tasklet_func, NULL);
+	irq_unmask(1);
+}
+
+char keyboard_getc(void) {
+	// Ждём нажатия в заблокированном состоянии, а не опросом: иначе
+	// оболочка не даёт работать задачам с более низким приоритетом
+	while (1) {
+		uint32_t flags = ticket_lock_irqsave(&key_lock);
+		char c = key_buffer_pop_locked();
+		if (c) {
+			ticket_unlock_irqrestore(&key_lock, flags);
+			return c;
+		}
+		// Пробуждение между unlock и schedule() отменит блокировку
+		key_waiter = current_task_TCB;
+		current_task_TCB->state = TASK_STATE_BLOCKED;
+		ticket_unlock(&key_lock);
+		schedule();
+		irq_restore(flags);
+	}
+}
+
+// Без ожидания: 0, если буфер пуст
+char keyboard_trygetc(void) {
+	uint32_t flags = ticket_lock_irqsave(&key_lock);
+	char c = key_buffer_pop_locked();
+	ticket_unlock_irqrestore(&key_lock, flags);
+	return c;
+}
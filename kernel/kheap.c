@@ -1,219 +1,566 @@
-#include <kheap.h>
-#include <pmm.h>
-#include <lib/string.h>
-#include <lib/stdio.h>
-#include <sync.h>
-
-#define BLOCK_HEADER_SIZE sizeof(block_t)
-#define MIN_ALLOC_SIZE PAGE_SIZE
-
-static LIST_HEAD(heap_list);
-static mutex_t heap_mutex;
-
-static void split_block(block_t *block, size_t size) {
-	if (!block || block->size < size + BLOCK_HEADER_SIZE + 16) {
-		return;
-	}
-
-	block_t *new_block = (block_t *)((uint8_t *)block + BLOCK_HEADER_SIZE + size);
-	new_block->magic = HEAP_MAGIC;
-	new_block->size = block->size - size - BLOCK_HEADER_SIZE;
-	new_block->free = 1;
-	list_add(&new_block->list, &block->list);
-
-	block->size = size;
-}
-
-static void merge_blocks(block_t *block) {
-	if (!block || !block->free) {
-		return;
-	}
-
-	list_head_t *pos, *n;
-	block_t *prev_block = NULL;
-	block_t *next_block = NULL;
-
-	list_for_each_safe(pos, n, &heap_list) {
-		block_t *current = list_entry(pos, block_t, list);
-		if (current == block) {
-			if (pos->prev != &heap_list) {
-				prev_block = list_entry(pos->prev, block_t, list);
-			}
-			if (pos->next != &heap_list) {
-				next_block = list_entry(pos->next, block_t, list);
-			}
-			break;
-		}
-	}
-
-	if (prev_block && prev_block->free && 
-		(uint8_t *)prev_block + BLOCK_HEADER_SIZE + prev_block->size == (uint8_t *)block) {
-		prev_block->size += BLOCK_HEADER_SIZE + block->size;
-		list_del(&block->list);
-		block = prev_block;
-    }
-
-	if (next_block && next_block->free && 
-		(uint8_t *)block + BLOCK_HEADER_SIZE + block->size == (uint8_t *)next_block) {
-		block->size += BLOCK_HEADER_SIZE + next_block->size;
-		list_del(&next_block->list);
-    }
-}
-
-void heap_init(void) {
-	list_init(&heap_list);
-	mutex_init(&heap_mutex);
-	printf("Heap: Initialized (empty)\n");
-}
-
-void *kmalloc(size_t size) {
-	if (size == 0) {
-		return NULL;
-	}
-
-	mutex_lock(&heap_mutex);
-	size = (size + 3) & ~3;
-
-	block_t *best = NULL;
-	size_t best_size = 0xFFFFFFFF;
-
-	list_head_t *pos;
-	list_for_each(pos, &heap_list) {
-		block_t *current = list_entry(pos, block_t, list);
-		if (current->free && current->size >= size && current->size < best_size) {
-			best = current;
-			best_size = current->size;
-		}
-	}
-
-	if (!best) {
-		size_t required_size = BLOCK_HEADER_SIZE + size;
-		size_t pages = (required_size + PAGE_SIZE - 1) / PAGE_SIZE;
-		void *new_pages = pmm_alloc(pages);
-		if (!new_pages) {
-			printf("Heap: Out of memory for %d bytes (%d pages)\n", size, pages);
-			mutex_unlock(&heap_mutex);
-			return NULL;
-		}
-
-		block_t *new_block = (block_t *)new_pages;
-		new_block->magic = HEAP_MAGIC;
-		new_block->size = pages * PAGE_SIZE - BLOCK_HEADER_SIZE;
-		new_block->free = 1;
-		list_add_tail(&new_block->list, &heap_list);
-
-		best = new_block;
-	}
-
-	split_block(best, size);
-
-	best->free = 0;
-	void *ptr = (void *)((uint8_t *)best + BLOCK_HEADER_SIZE);
-	printf("Heap: Allocated %d bytes at 0x%x\n", size, (uint32_t)ptr);
-	mutex_unlock(&heap_mutex);
-	return ptr;
-}
-
-void kfree(void *ptr) {
-	if (!ptr) {
-		return;
-	}
-
-	mutex_lock(&heap_mutex);
-	block_t *block = (block_t *)((uint8_t *)ptr - BLOCK_HEADER_SIZE);
-
-	list_head_t *pos;
-	int found = 0;
-	list_for_each(pos, &heap_list) {
-		if (pos == &block->list) {
-			found = 1;
-			break;
-		}
-	}
-	if (!found || block->free || block->magic != HEAP_MAGIC) {
-		printf("Heap: Invalid free at 0x%x (found=%d, free=%d, magic=0x%x)\n", 
-				(uint32_t)ptr, found, block->free, block->magic);
-		mutex_unlock(&heap_mutex);
-		return;
-    }
-
-	printf("Heap: Freeing %d bytes at 0x%x\n", block->size, (uint32_t)ptr);
-	memset(ptr, 0, block->size);
-	block->free = 1;
-
-	merge_blocks(block);
-
-	if (block->free && ((uint32_t)block % PAGE_SIZE) == 0) {
-		size_t total_size = BLOCK_HEADER_SIZE + block->size;
-		size_t block_pages = (total_size + PAGE_SIZE - 1) / PAGE_SIZE;
-
-		int can_free = 1;
-		list_for_each(pos, &heap_list) {
-			block_t *other = list_entry(pos, block_t, list);
-			if (other != block) {
-				uint32_t other_start = (uint32_t)other;
-				uint32_t other_end = other_start + BLOCK_HEADER_SIZE + other->size;
-				uint32_t block_start = (uint32_t)block;
-				uint32_t block_end = block_start + total_size;
-
-				if ((other_start < block_end && other_end > block_start) || 
-					(block_start < other_end && block_end > other_start)) {
-					can_free = 0; // Пересечение с другим блоком
-					break;
-				}
-			}
-		}
-
-		if (can_free && list_empty(&heap_list)) {
-			printf("Heap: Releasing %d pages at 0x%x to PMM (entire heap)\n", block_pages, (uint32_t)block);
-			pmm_free(block, block_pages);
-			list_init(&heap_list);
-		} else if (can_free && &block->list == heap_list.next && block->list.next != &heap_list) {
-			printf("Heap: Releasing %d pages at 0x%x to PMM (head)\n", block_pages, (uint32_t)block);
-			list_del(&block->list);
-			pmm_free(block, block_pages);
-		} else if (can_free && &block->list == heap_list.prev && block->list.prev != &heap_list) {
-			printf("Heap: Releasing %d pages at 0x%x to PMM (tail)\n", block_pages, (uint32_t)block);
-			list_del(&block->list);
-			pmm_free(block, block_pages);
-		}
-	}
-
-	mutex_unlock(&heap_mutex);
-}
-
-int kwrite(void *ptr, const void *data, size_t size) {
-	if (!ptr || !data || size == 0) {
-		printf("Heap: Invalid kwrite parameters (ptr=0x%x, data=0x%x, size=%d)\n", 
-				(uint32_t)ptr, (uint32_t)data, size);
-		return -1;
-	}
-
-	mutex_lock(&heap_mutex);
-	block_t *block = (block_t *)((uint8_t *)ptr - BLOCK_HEADER_SIZE);
-    
-	list_head_t *pos;
-	int found = 0;
-	list_for_each(pos, &heap_list) {
-		if (pos == &block->list) {
-			found = 1;
-			break;
-		}
-    }
-	if (!found || block->free || block->magic != HEAP_MAGIC) {
-		printf("Heap: Invalid memory block at 0x%x for kwrite\n", (uint32_t)ptr);
-		mutex_unlock(&heap_mutex);
-		return -1;
-    }
-
-	if (size > block->size) {
-		printf("Heap: Write size %d exceeds block size %d at 0x%x\n", size, block->size, (uint32_t)ptr);
-		mutex_unlock(&heap_mutex);
-		return -1;
-	}
-
-	memcpy(ptr, data, size);
-	printf("Heap: Wrote %d bytes to 0x%x\n", size, (uint32_t)ptr);
-	mutex_unlock(&heap_mutex);
-	return size;
+#include <kheap.h>
+#include <pmm.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <sync.h>
+#include <slab.h>
+#include <magazine.h>
+#include <x86.h>
+#include <spinlock.h>
+#include <klog.h>
+#include <panic.h>
+
+#define BLOCK_HEADER_SIZE sizeof(block_t)
+#define BLOCK_FOOTER_SIZE sizeof(block_footer_t)
+#define BLOCK_OVERHEAD (BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE)
+#define HEAP_MIN_SPLIT 64
+#define HEAP_MIN_CHUNK_PAGES 4
+
+// Узел свободного списка хранится в полезной нагрузке свободного блока
+#define block_link(block) ((list_head_t *)((uint8_t *)(block) + BLOCK_HEADER_SIZE))
+
+static LIST_HEAD(heap_chunks);
+static list_head_t heap_bins[HEAP_BINS];
+static uint32_t heap_bin_mask = 0;
+static mutex_t heap_mutex;
+static int zero_on_free = KHEAP_ZERO_ON_FREE;
+static LIST_HEAD(heap_large);
+static kmem_cache_t *large_cache = NULL;
+static kheap_stats_t stats;
+static spinlock_t stats_lock = SPINLOCK_INIT;
+#if KHEAP_TRACK_CALLERS
+static kheap_caller_t callers[KHEAP_CALLER_SLOTS];
+#endif
+
+static inline block_footer_t *block_footer(block_t *block) {
+	return (block_footer_t *)((uint8_t *)block + BLOCK_HEADER_SIZE + block->size);
+}
+
+static inline block_t *block_next(block_t *block) {
+	return (block_t *)((uint8_t *)block + BLOCK_OVERHEAD + block->size);
+}
+
+static inline block_t *block_prev(block_t *block) {
+	block_footer_t *footer = (block_footer_t *)((uint8_t *)block - BLOCK_FOOTER_SIZE);
+	if (footer->size == 0) {
+		return NULL;
+	}
+	return (block_t *)((uint8_t *)footer - footer->size - BLOCK_HEADER_SIZE);
+}
+
+static void block_set(block_t *block, size_t size, uint32_t free) {
+	block->magic = HEAP_MAGIC;
+	block->size = size;
+	block->free = free;
+	block_footer_t *footer = block_footer(block);
+	footer->magic = HEAP_MAGIC;
+	footer->size = size;
+}
+
+static uint32_t heap_bin_for(size_t size) {
+	uint32_t bin = 31 - __builtin_clz(size);
+	bin = bin > 3 ? bin - 3 : 0;
+	return bin < HEAP_BINS ? bin : HEAP_BINS - 1;
+}
+
+static void heap_bin_insert(block_t *block) {
+	block->bin = heap_bin_for(block->size);
+	list_add(block_link(block), &heap_bins[block->bin]);
+	heap_bin_mask |= 1u << block->bin;
+}
+
+static void heap_bin_remove(block_t *block) {
+	list_del(block_link(block));
+	if (list_empty(&heap_bins[block->bin])) {
+		heap_bin_mask &= ~(1u << block->bin);
+	}
+}
+
+static block_t *heap_find_fit(size_t size) {
+	uint32_t bin = heap_bin_for(size);
+
+	list_head_t *pos;
+	list_for_each(pos, &heap_bins[bin]) {
+		block_t *block = (block_t *)((uint8_t *)pos - BLOCK_HEADER_SIZE);
+		if (block->size >= size) {
+			return block;
+		}
+	}
+
+	// В старших корзинах любой блок заведомо достаточно велик
+	uint32_t avail = bin + 1 < HEAP_BINS ? heap_bin_mask >> (bin + 1) : 0;
+	if (!avail) {
+		return NULL;
+	}
+	bin += 1 + __builtin_ctz(avail);
+	return (block_t *)((uint8_t *)heap_bins[bin].next - BLOCK_HEADER_SIZE);
+}
+
+static block_t *heap_grow(size_t size) {
+	size_t required_size = sizeof(heap_chunk_t) + BLOCK_OVERHEAD + size + BLOCK_HEADER_SIZE;
+	size_t pages = (required_size + PAGE_SIZE - 1) / PAGE_SIZE;
+	if (pages < HEAP_MIN_CHUNK_PAGES) {
+		pages = HEAP_MIN_CHUNK_PAGES;
+	}
+
+	heap_chunk_t *chunk = (heap_chunk_t *)pmm_alloc(pages);
+	if (!chunk) {
+		klog(KLOG_ERR, "Heap: Out of memory for %d bytes (%d pages)\n", size, pages);
+		return NULL;
+	}
+
+	chunk->magic = HEAP_CHUNK_MAGIC;
+	chunk->pages = pages;
+	chunk->prologue.magic = HEAP_MAGIC;
+	chunk->prologue.size = 0;
+	list_add_tail(&chunk->list, &heap_chunks);
+	pmm_set_owner(chunk, pages, PMM_OWNER_HEAP, chunk);
+	stats.pages_held += pages;
+	stats.pages_grown += pages;
+
+	block_t *block = (block_t *)(chunk + 1);
+	block_set(block, pages * PAGE_SIZE - sizeof(heap_chunk_t) - BLOCK_OVERHEAD - BLOCK_HEADER_SIZE, 1);
+
+	block_t *epilogue = block_next(block);
+	epilogue->magic = HEAP_MAGIC;
+	epilogue->size = 0;
+	epilogue->free = 0;
+
+	return block;
+}
+
+// Сдвигает полезную нагрузку на границу align, отдавая голову блока
+// в корзины отдельным свободным блоком
+static block_t *heap_align_block(block_t *block, size_t align) {
+	uint32_t payload = (uint32_t)block + BLOCK_HEADER_SIZE;
+	if (!(payload & (align - 1))) {
+		return block;
+	}
+
+	uint32_t aligned = (payload + BLOCK_OVERHEAD + HEAP_MIN_SPLIT + align - 1) & ~(align - 1);
+	size_t lead = aligned - payload;
+	size_t size = block->size - lead;
+
+	block_set(block, lead - BLOCK_OVERHEAD, 1);
+	heap_bin_insert(block);
+
+	block = (block_t *)(aligned - BLOCK_HEADER_SIZE);
+	block_set(block, size, 0);
+	return block;
+}
+
+static void heap_release_chunk(heap_chunk_t *chunk) {
+	klog(KLOG_DEBUG, "Heap: Releasing %d pages at 0x%x to PMM\n", chunk->pages, (uint32_t)chunk);
+	list_del(&chunk->list);
+	chunk->magic = 0;
+	stats.pages_held -= chunk->pages;
+	stats.pages_returned += chunk->pages;
+	pmm_set_owner(chunk, chunk->pages, PMM_OWNER_NONE, NULL);
+	pmm_free(chunk, chunk->pages);
+}
+
+static void split_block(block_t *block, size_t size) {
+	if (!block || block->size < size + BLOCK_OVERHEAD + HEAP_MIN_SPLIT) {
+		return;
+	}
+
+	size_t rest = block->size - size - BLOCK_OVERHEAD;
+	block_set(block, size, block->free);
+
+	block_t *new_block = block_next(block);
+	block_set(new_block, rest, 1);
+	heap_bin_insert(new_block);
+}
+
+static block_t *merge_blocks(block_t *block) {
+	block_t *prev_block = block_prev(block);
+	if (prev_block && prev_block->free) {
+		heap_bin_remove(prev_block);
+		block_set(prev_block, prev_block->size + BLOCK_OVERHEAD + block->size, 1);
+		block = prev_block;
+	}
+
+	block_t *next_block = block_next(block);
+	if (next_block->size && next_block->free) {
+		heap_bin_remove(next_block);
+		block_set(block, block->size + BLOCK_OVERHEAD + next_block->size, 1);
+	}
+	return block;
+}
+
+// Проверка указателя за O(1): владелец страницы, заголовок и футер
+static block_t *heap_block_of(void *ptr) {
+	void *data;
+	if (pmm_get_owner(ptr, &data) != PMM_OWNER_HEAP) {
+		return NULL;
+	}
+
+	heap_chunk_t *chunk = (heap_chunk_t *)data;
+	uint8_t *chunk_end = (uint8_t *)chunk + chunk->pages * PAGE_SIZE;
+	block_t *block = (block_t *)((uint8_t *)ptr - BLOCK_HEADER_SIZE);
+	if (chunk->magic != HEAP_CHUNK_MAGIC || (uint8_t *)block < (uint8_t *)(chunk + 1) ||
+		block->magic != HEAP_MAGIC || block->size == 0 ||
+		(uint8_t *)ptr + block->size + BLOCK_FOOTER_SIZE > chunk_end) {
+		return NULL;
+	}
+
+	block_footer_t *footer = block_footer(block);
+	if (footer->magic != HEAP_MAGIC || footer->size != block->size) {
+		return NULL;
+	}
+	return block;
+}
+
+static uint32_t heap_hist_bucket(size_t size) {
+	uint32_t bucket = size <= 1 ? 0 : 32 - __builtin_clz(size - 1);
+	return bucket < KHEAP_HIST_BUCKETS ? bucket : KHEAP_HIST_BUCKETS - 1;
+}
+
+#if KHEAP_TRACK_CALLERS
+static void heap_record_caller(void *caller, size_t size) {
+	uint32_t slot = ((uint32_t)caller >> 2) % KHEAP_CALLER_SLOTS;
+	for (uint32_t i = 0; i < KHEAP_CALLER_SLOTS; i++) {
+		kheap_caller_t *entry = &callers[(slot + i) % KHEAP_CALLER_SLOTS];
+		if (entry->caller == caller || !entry->caller) {
+			entry->caller = caller;
+			entry->allocs++;
+			entry->bytes += size;
+			return;
+		}
+	}
+}
+#endif
+
+static void heap_account_alloc(int cls, size_t request, size_t size, void *caller) {
+	uint32_t flags = spin_lock_irqsave(&stats_lock);
+	stats.allocs[cls]++;
+	stats.histogram[heap_hist_bucket(request)]++;
+	stats.bytes_in_use += size;
+	if (stats.bytes_in_use > stats.peak_bytes) {
+		stats.peak_bytes = stats.bytes_in_use;
+	}
+#if KHEAP_TRACK_CALLERS
+	heap_record_caller(caller, size);
+#else
+	(void)caller;
+#endif
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+static void heap_account_failed(void) {
+	uint32_t flags = spin_lock_irqsave(&stats_lock);
+	stats.failed++;
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+static void heap_account_free(int cls, size_t size) {
+	uint32_t flags = spin_lock_irqsave(&stats_lock);
+	stats.frees[cls]++;
+	stats.bytes_in_use -= size;
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+void heap_init(void) {
+	list_init(&heap_chunks);
+	for (int i = 0; i < HEAP_BINS; i++) {
+		list_init(&heap_bins[i]);
+	}
+	heap_bin_mask = 0;
+	mutex_init(&heap_mutex);
+	list_init(&heap_large);
+	slab_init();
+	magazine_init();
+	large_cache = kmem_cache_create("kheap_large", sizeof(kheap_large_t), 0);
+	if (!large_cache) {
+		panic_custom("Failed to create large allocation cache");
+	}
+	printf("Heap: Initialized (empty)\n");
+}
+
+static void *kmalloc_small(size_t request, kmem_cache_t *cache, void *caller) {
+	void *obj = magazine_alloc(cache);
+	if (obj) {
+		heap_account_alloc(kmalloc_index(cache), request, cache->object_size, caller);
+	} else {
+		heap_account_failed();
+	}
+	return obj;
+}
+
+static void *kmalloc_block(size_t request, size_t align, void *caller) {
+	mutex_lock(&heap_mutex);
+	size_t size = (request + 7) & ~7;
+	size_t search = align > 8 ? size + align + BLOCK_OVERHEAD + HEAP_MIN_SPLIT : size;
+
+	block_t *best = heap_find_fit(search);
+	if (best) {
+		heap_bin_remove(best);
+	} else {
+		best = heap_grow(search);
+		if (!best) {
+			heap_account_failed();
+			mutex_unlock(&heap_mutex);
+			return NULL;
+		}
+	}
+
+	best->free = 0;
+	if (align > 8) {
+		best = heap_align_block(best, align);
+	}
+	split_block(best, size);
+	heap_account_alloc(KHEAP_CLASS_BLOCK, request, best->size, caller);
+
+	void *ptr = (void *)((uint8_t *)best + BLOCK_HEADER_SIZE);
+	klog(KLOG_DEBUG, "Heap: Allocated %d bytes at 0x%x\n", size, (uint32_t)ptr);
+	mutex_unlock(&heap_mutex);
+	return ptr;
+}
+
+// Крупные запросы идут прямо в PMM: страницы выровнены на размер
+// блока buddy, поэтому align больше страницы достигается округлением
+static void *kmalloc_large(size_t request, size_t align, int zero, void *caller) {
+	uint32_t pages = (request + PAGE_SIZE - 1) / PAGE_SIZE;
+	uint32_t alloc_pages = pages;
+	if (align > PAGE_SIZE && alloc_pages < align / PAGE_SIZE) {
+		alloc_pages = align / PAGE_SIZE;
+	}
+
+	kheap_large_t *large = (kheap_large_t *)kmem_cache_alloc(large_cache);
+	if (!large) {
+		heap_account_failed();
+		return NULL;
+	}
+
+	void *addr = zero ? pmm_alloc_zeroed(alloc_pages) : pmm_alloc(alloc_pages);
+	if (!addr) {
+		kmem_cache_free(large_cache, large);
+		heap_account_failed();
+		klog(KLOG_ERR, "Heap: Out of memory for %d bytes (%d pages)\n", request, pages);
+		return NULL;
+	}
+	if (alloc_pages > pages) {
+		pmm_free((uint8_t *)addr + pages * PAGE_SIZE, alloc_pages - pages);
+	}
+
+	large->addr = addr;
+	large->pages = pages;
+	large->size = request;
+	pmm_set_owner(addr, pages, PMM_OWNER_LARGE, large);
+
+	mutex_lock(&heap_mutex);
+	list_add(&large->list, &heap_large);
+	stats.large_pages += pages;
+	mutex_unlock(&heap_mutex);
+
+	heap_account_alloc(KHEAP_CLASS_LARGE, request, pages * PAGE_SIZE, caller);
+	klog(KLOG_DEBUG, "Heap: Allocated %d pages at 0x%x\n", pages, (uint32_t)addr);
+	return addr;
+}
+
+static kheap_large_t *heap_large_of(void *ptr) {
+	void *data;
+	if (pmm_get_owner(ptr, &data) != PMM_OWNER_LARGE) {
+		return NULL;
+	}
+
+	kheap_large_t *large = (kheap_large_t *)data;
+	return large->addr == ptr ? large : NULL;
+}
+
+// Вызывается после того, как запись снята со списка под heap_mutex
+static void kfree_large(void *ptr, kheap_large_t *large) {
+	heap_account_free(KHEAP_CLASS_LARGE, large->pages * PAGE_SIZE);
+	klog(KLOG_DEBUG, "Heap: Freeing %d pages at 0x%x\n", large->pages, (uint32_t)ptr);
+	if (zero_on_free) {
+		memset(ptr, 0, large->pages * PAGE_SIZE);
+	}
+	pmm_set_owner(ptr, large->pages, PMM_OWNER_NONE, NULL);
+	pmm_free(ptr, large->pages);
+	kmem_cache_free(large_cache, large);
+}
+
+static void *kmalloc_caller(size_t request, size_t align, int zero, void *caller) {
+	if (request == 0) {
+		return NULL;
+	}
+	if (align & (align - 1)) {
+		klog(KLOG_ERR, "Heap: Invalid alignment %d\n", align);
+		return NULL;
+	}
+
+	// Классы kmalloc выровнены на свой размер
+	size_t slab_size = request > align ? request : align;
+	kmem_cache_t *cache = kmalloc_slab(slab_size);
+	if (cache) {
+		return kmalloc_small(request, cache, caller);
+	}
+	if (request >= KHEAP_LARGE_MIN || align >= PAGE_SIZE) {
+		return kmalloc_large(request, align, zero, caller);
+	}
+	return kmalloc_block(request, align, caller);
+}
+
+void *kmalloc(size_t size) {
+	return kmalloc_caller(size, 8, 0, __builtin_return_address(0));
+}
+
+void *kmalloc_aligned(size_t size, size_t align) {
+	return kmalloc_caller(size, align, 0, __builtin_return_address(0));
+}
+
+// Страничные выделения берут уже обнулённые страницы из пула PMM
+void *kzalloc(size_t size) {
+	void *ptr = kmalloc_caller(size, 8, 1, __builtin_return_address(0));
+	if (ptr && size < KHEAP_LARGE_MIN) {
+		memset(ptr, 0, size);
+	}
+	return ptr;
+}
+
+void kfree(void *ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	slab_t *slab = slab_of(ptr);
+	if (slab) {
+		if (!slab_object_valid(slab, ptr)) {
+			klog(KLOG_ERR, "Heap: Invalid free at 0x%x (not a slab object)\n", (uint32_t)ptr);
+			return;
+		}
+		int cls = kmalloc_index(slab->cache);
+		if (cls >= 0) {
+			heap_account_free(cls, slab->cache->object_size);
+		}
+		if (zero_on_free) {
+			memset(ptr, 0, slab->cache->object_size);
+		}
+		magazine_free(slab->cache, ptr);
+		return;
+	}
+
+	mutex_lock(&heap_mutex);
+	kheap_large_t *large = heap_large_of(ptr);
+	if (large) {
+		list_del(&large->list);
+		large->addr = NULL;
+		stats.large_pages -= large->pages;
+		mutex_unlock(&heap_mutex);
+		kfree_large(ptr, large);
+		return;
+	}
+
+	block_t *block = heap_block_of(ptr);
+	if (!block || block->free) {
+		klog(KLOG_ERR, "Heap: Invalid free at 0x%x (found=%d, free=%d)\n",
+				(uint32_t)ptr, block != NULL, block ? block->free : 0);
+		mutex_unlock(&heap_mutex);
+		return;
+	}
+
+	klog(KLOG_DEBUG, "Heap: Freeing %d bytes at 0x%x\n", block->size, (uint32_t)ptr);
+	heap_account_free(KHEAP_CLASS_BLOCK, block->size);
+	if (zero_on_free) {
+		memset(ptr, 0, block->size);
+	}
+	block->free = 1;
+
+	block = merge_blocks(block);
+
+	// Блок занял весь чанк целиком: возвращаем страницы в PMM
+	if (!block_prev(block) && block_next(block)->size == 0) {
+		heap_release_chunk((heap_chunk_t *)((uint8_t *)block - sizeof(heap_chunk_t)));
+	} else {
+		heap_bin_insert(block);
+	}
+
+	mutex_unlock(&heap_mutex);
+}
+
+int kwrite(void *ptr, const void *data, size_t size) {
+	if (!ptr || !data || size == 0) {
+		klog(KLOG_ERR, "Heap: Invalid kwrite parameters (ptr=0x%x, data=0x%x, size=%d)\n",
+				(uint32_t)ptr, (uint32_t)data, size);
+		return -1;
+	}
+
+	slab_t *slab = slab_of(ptr);
+	if (slab) {
+		if (!slab_object_valid(slab, ptr) || size > slab->cache->object_size) {
+			klog(KLOG_ERR, "Heap: Invalid slab object 0x%x or size %d for kwrite\n", (uint32_t)ptr, size);
+			return -1;
+		}
+		memcpy(ptr, data, size);
+		return size;
+	}
+
+	mutex_lock(&heap_mutex);
+	kheap_large_t *large = heap_large_of(ptr);
+	if (large) {
+		if (size > large->pages * PAGE_SIZE) {
+			klog(KLOG_ERR, "Heap: Write size %d exceeds %d pages at 0x%x\n", size, large->pages, (uint32_t)ptr);
+			mutex_unlock(&heap_mutex);
+			return -1;
+		}
+		memcpy(ptr, data, size);
+		mutex_unlock(&heap_mutex);
+		return size;
+	}
+
+	block_t *block = heap_block_of(ptr);
+	if (!block || block->free) {
+		klog(KLOG_ERR, "Heap: Invalid memory block at 0x%x for kwrite\n", (uint32_t)ptr);
+		mutex_unlock(&heap_mutex);
+		return -1;
+	}
+
+	if (size > block->size) {
+		klog(KLOG_ERR, "Heap: Write size %d exceeds block size %d at 0x%x\n", size, block->size, (uint32_t)ptr);
+		mutex_unlock(&heap_mutex);
+		return -1;
+	}
+
+	memcpy(ptr, data, size);
+	klog(KLOG_DEBUG, "Heap: Wrote %d bytes to 0x%x\n", size, (uint32_t)ptr);
+	mutex_unlock(&heap_mutex);
+	return size;
+}
+
+void kheap_set_zero_on_free(int enable) {
+	zero_on_free = enable;
+	printf("Heap: Zeroing on free %s\n", enable ? "enabled" : "disabled");
+}
+
+void kheap_get_stats(kheap_stats_t *out) {
+	mutex_lock(&heap_mutex);
+	uint32_t flags = spin_lock_irqsave(&stats_lock);
+	*out = stats;
+	spin_unlock_irqrestore(&stats_lock, flags);
+
+	out->free_bytes = 0;
+	out->free_blocks = 0;
+	out->largest_free = 0;
+	for (int i = 0; i < HEAP_BINS; i++) {
+		list_head_t *pos;
+		list_for_each(pos, &heap_bins[i]) {
+			block_t *block = (block_t *)((uint8_t *)pos - BLOCK_HEADER_SIZE);
+			out->free_bytes += block->size;
+			out->free_blocks++;
+			if (block->size > out->largest_free) {
+				out->largest_free = block->size;
+			}
+		}
+	}
+	mutex_unlock(&heap_mutex);
+}
+
+uint32_t kheap_get_callers(const kheap_caller_t **out) {
+#if KHEAP_TRACK_CALLERS
+	*out = callers;
+	return KHEAP_CALLER_SLOTS;
+#else
+	*out = NULL;
+	return 0;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <klog.h>
+#include <timer.h>
+#include <lib/stdio.h>
+#include <lib/stdarg.h>
+#include <lib/string.h>
+
+volatile int klog_level = KLOG_DEFAULT_LEVEL;
+
+static klog_record_t klog_ring[KLOG_RECORDS];
+static volatile uint32_t klog_head = 0;
+static uint32_t klog_tail = 0;
+static uint32_t klog_lost = 0;
+// Сообщения, для которых не нашлось свободного слота
+static volatile uint32_t klog_dropped = 0;
+
+static const char *klog_names[] = {
+	"emerg", "alert", "crit", "err", "warn", "notice", "info", "debug"
+};
+
+// Писатель сначала занимает слот, потом номер записи, пишет текст и
+// только потом публикует seq. Слот, который ещё пишет отставший на целый
+// круг писатель, не ждём: это может быть прерванный нами же код, и
+// сообщение теряется. Так в одном слоте не бывает двух писателей, и seq
+// в нём только растёт. Читатель сверяет seq до и после копирования,
+// поэтому перезаписанная во время чтения запись просто пропускается
+void klog_write(int level, const char *format, ...) {
+	uint32_t seq;
+	klog_record_t *rec;
+	while (1) {
+		seq = klog_head;
+		rec = &klog_ring[seq & (KLOG_RECORDS - 1)];
+		if (__sync_lock_test_and_set(&rec->busy, 1)) {
+			__sync_fetch_and_add(&klog_dropped, 1);
+			return;
+		}
+		if (__sync_bool_compare_and_swap(&klog_head, seq, seq + 1)) {
+			break;
+		}
+		__sync_lock_release(&rec->busy);
+	}
+
+	rec->seq = 0;
+	__sync_synchronize();
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(rec->text, KLOG_MSG_SIZE, format, args);
+	va_end(args);
+	rec->ticks = system_timer.ticks;
+	rec->level = level;
+
+	__sync_synchronize();
+	rec->seq = seq + 1;
+	__sync_lock_release(&rec->busy);
+}
+
+static int klog_read(uint32_t seq, klog_record_t *out) {
+	klog_record_t *rec = &klog_ring[seq & (KLOG_RECORDS - 1)];
+	if (rec->seq != seq + 1) {
+		return 0;
+	}
+	__sync_synchronize();
+	memcpy(out, rec, sizeof(klog_record_t));
+	__sync_synchronize();
+	return rec->seq == seq + 1;
+}
+
+static void klog_print(const klog_record_t *rec) {
+	uint32_t level = rec->level < 8 ? rec->level : KLOG_DEBUG;
+	printf("[%d] %s: %s", rec->ticks, klog_names[level], rec->text);
+}
+
+void klog_set_level(int level) {
+	if (level < KLOG_EMERG) {
+		level = KLOG_EMERG;
+	} else if (level > KLOG_DEBUG) {
+		level = KLOG_DEBUG;
+	}
+	klog_level = level;
+}
+
+int klog_get_level(void) {
+	return klog_level;
+}
+
+// Выводит всё, что накопилось с прошлого вызова. Незакоммиченная запись
+// останавливает вывод до следующего раза
+void klog_flush(void) {
+	klog_record_t rec;
+	uint32_t head = klog_head;
+
+	if (head - klog_tail > KLOG_RECORDS) {
+		klog_lost += head - klog_tail - KLOG_RECORDS;
+		klog_tail = head - KLOG_RECORDS;
+	}
+	klog_lost += __sync_lock_test_and_set(&klog_dropped, 0);
+	if (klog_lost) {
+		printf("klog: %d messages lost\n", klog_lost);
+		klog_lost = 0;
+	}
+
+	while (klog_tail != head) {
+		if (!klog_read(klog_tail, &rec)) {
+			klog_record_t *slot = &klog_ring[klog_tail & (KLOG_RECORDS - 1)];
+			if (slot->seq > klog_tail + 1) {
+				klog_tail++;
+				klog_lost++;
+				continue;
+			}
+			break;
+		}
+		klog_print(&rec);
+		klog_tail++;
+	}
+}
+
+void klog_dump(void) {
+	klog_record_t rec;
+	uint32_t head = klog_head;
+	uint32_t seq = head > KLOG_RECORDS ? head - KLOG_RECORDS : 0;
+
+	for (; seq != head; seq++) {
+		if (klog_read(seq, &rec)) {
+			klog_print(&rec);
+		}
+	}
+}
+
+void klog_task(void) {
+	while (1) {
+		klog_flush();
+		sleep(KLOG_FLUSH_INTERVAL);
+	}
+}
@@ -0,0 +1,208 @@
+#include <magazine.h>
+#include <task.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <panic.h>
+
+static kmem_cache_t *magazine_cache = NULL;
+static kmem_cache_t *magazines_cache = NULL;
+static magazine_depot_t depots[KMALLOC_CLASSES];
+
+static inline kmem_magazines_t *current_magazines(void) {
+	return current_task_TCB ? current_task_TCB->magazines : NULL;
+}
+
+// Магазины задачи защищены запретом прерываний, депо общее для всех
+// CPU и берётся под своей блокировкой только на время работы со списками
+static void depot_put_empty(uint32_t idx, magazine_t *mag) {
+	magazine_depot_t *depot = &depots[idx];
+	spin_lock(&depot->lock);
+	if (depot->empty_count >= MAGAZINE_DEPOT_MAX_FULL) {
+		spin_unlock(&depot->lock);
+		kmem_cache_free(magazine_cache, mag);
+		return;
+	}
+	list_add(&mag->list, &depot->empty);
+	depot->empty_count++;
+	spin_unlock(&depot->lock);
+}
+
+static void magazine_flush(kmem_cache_t *cache, magazine_t *mag) {
+	while (mag->rounds) {
+		kmem_cache_free(cache, mag->objs[--mag->rounds]);
+	}
+}
+
+static void depot_put_full(uint32_t idx, kmem_cache_t *cache, magazine_t *mag) {
+	magazine_depot_t *depot = &depots[idx];
+	spin_lock(&depot->lock);
+	if (depot->full_count >= MAGAZINE_DEPOT_MAX_FULL) {
+		spin_unlock(&depot->lock);
+		magazine_flush(cache, mag);
+		depot_put_empty(idx, mag);
+		return;
+	}
+	list_add(&mag->list, &depot->full);
+	depot->full_count++;
+	spin_unlock(&depot->lock);
+}
+
+static magazine_t *depot_get_full(uint32_t idx) {
+	magazine_depot_t *depot = &depots[idx];
+	spin_lock(&depot->lock);
+	if (list_empty(&depot->full)) {
+		spin_unlock(&depot->lock);
+		return NULL;
+	}
+	magazine_t *mag = list_entry(depot->full.next, magazine_t, list);
+	list_del(&mag->list);
+	depot->full_count--;
+	spin_unlock(&depot->lock);
+	return mag;
+}
+
+static magazine_t *depot_get_empty(uint32_t idx) {
+	magazine_depot_t *depot = &depots[idx];
+	spin_lock(&depot->lock);
+	if (list_empty(&depot->empty)) {
+		spin_unlock(&depot->lock);
+		magazine_t *mag = (magazine_t *)kmem_cache_alloc(magazine_cache);
+		if (mag) {
+			mag->rounds = 0;
+		}
+		return mag;
+	}
+	magazine_t *mag = list_entry(depot->empty.next, magazine_t, list);
+	list_del(&mag->list);
+	depot->empty_count--;
+	spin_unlock(&depot->lock);
+	return mag;
+}
+
+static void magazine_return(uint32_t idx, kmem_cache_t *cache, magazine_t *mag) {
+	if (!mag) {
+		return;
+	}
+	if (mag->rounds == MAGAZINE_SIZE) {
+		depot_put_full(idx, cache, mag);
+	} else {
+		magazine_flush(cache, mag);
+		depot_put_empty(idx, mag);
+	}
+}
+
+void magazine_init(void) {
+	magazine_cache = kmem_cache_create("magazine", sizeof(magazine_t), 0);
+	magazines_cache = kmem_cache_create("kmem_magazines", sizeof(kmem_magazines_t), 0);
+	if (!magazine_cache || !magazines_cache) {
+		panic_custom("Failed to create magazine caches");
+	}
+
+	for (int i = 0; i < KMALLOC_CLASSES; i++) {
+		spin_lock_init(&depots[i].lock);
+		list_init(&depots[i].full);
+		list_init(&depots[i].empty);
+		depots[i].full_count = 0;
+		depots[i].empty_count = 0;
+	}
+}
+
+kmem_magazines_t *magazine_create(void) {
+	if (!magazines_cache) {
+		return NULL;
+	}
+
+	kmem_magazines_t *mags = (kmem_magazines_t *)kmem_cache_alloc(magazines_cache);
+	if (mags) {
+		memset(mags, 0, sizeof(kmem_magazines_t));
+	}
+	return mags;
+}
+
+void magazine_destroy(kmem_magazines_t *mags) {
+	if (!mags) {
+		return;
+	}
+
+	uint32_t flags = irq_save();
+	for (int i = 0; i < KMALLOC_CLASSES; i++) {
+		kmem_cache_t *cache = kmalloc_slab(KMALLOC_MIN_SIZE << i);
+		magazine_return(i, cache, mags->loaded[i]);
+		magazine_return(i, cache, mags->previous[i]);
+	}
+	irq_restore(flags);
+
+	kmem_cache_free(magazines_cache, mags);
+}
+
+void *magazine_alloc(kmem_cache_t *cache) {
+	int idx = kmalloc_index(cache);
+	kmem_magazines_t *mags = current_magazines();
+	if (idx < 0 || !mags) {
+		return kmem_cache_alloc(cache);
+	}
+
+	uint32_t flags = irq_save();
+	magazine_t *mag = mags->loaded[idx];
+	if (!mag || !mag->rounds) {
+		magazine_t *prev = mags->previous[idx];
+		if (prev && prev->rounds) {
+			mags->previous[idx] = mag;
+			mags->loaded[idx] = prev;
+			mag = prev;
+		} else {
+			magazine_t *full = depot_get_full(idx);
+			if (!full) {
+				irq_restore(flags);
+				return kmem_cache_alloc(cache);
+			}
+			if (prev) {
+				depot_put_empty(idx, prev);
+			}
+			mags->previous[idx] = mag;
+			mags->loaded[idx] = full;
+			mag = full;
+		}
+	}
+
+	void *obj = mag->objs[--mag->rounds];
+	irq_restore(flags);
+	return obj;
+}
+
+void magazine_free(kmem_cache_t *cache, void *obj) {
+	int idx = kmalloc_index(cache);
+	kmem_magazines_t *mags = current_magazines();
+	if (idx < 0 || !mags) {
+		kmem_cache_free(cache, obj);
+		return;
+	}
+
+	uint32_t flags = irq_save();
+	magazine_t *mag = mags->loaded[idx];
+	if (!mag || mag->rounds == MAGAZINE_SIZE) {
+		magazine_t *prev = mags->previous[idx];
+		if (prev && prev->rounds == 0) {
+			mags->previous[idx] = mag;
+			mags->loaded[idx] = prev;
+			mag = prev;
+		} else {
+			magazine_t *empty = depot_get_empty(idx);
+			if (!empty) {
+				irq_restore(flags);
+				kmem_cache_free(cache, obj);
+				return;
+			}
+			if (prev) {
+				depot_put_full(idx, cache, prev);
+			}
+			mags->previous[idx] = mag;
+			mags->loaded[idx] = empty;
+			mag = empty;
+		}
+	}
+
+	mag->objs[mag->rounds++] = obj;
+	irq_restore(flags);
+}
\ No newline at end of file
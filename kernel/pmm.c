@@ -1,156 +1,549 @@
-#include <pmm.h>
-#include <lib/string.h>
-#include <lib/stdio.h>
-#include <x86.h>
-
-static uint8_t *pmm_bitmap = NULL;
-static uint32_t bitmap_size = 0;
-static uint32_t total_pages = 0;
-static uint32_t free_pages = 0;
-static uint32_t memory_base = 0;
-
-static void pmm_set_bit(uint32_t page_idx) {
-	uint32_t byte_idx = page_idx / 8;
-	uint8_t bit_idx = page_idx % 8;
-	pmm_bitmap[byte_idx] |= (1 << bit_idx);
-}
-
-static void pmm_clear_bit(uint32_t page_idx) {
-	uint32_t byte_idx = page_idx / 8;
-	uint8_t bit_idx = page_idx % 8;
-	pmm_bitmap[byte_idx] &= ~(1 << bit_idx);
-}
-
-static int pmm_test_bit(uint32_t page_idx) {
-	uint32_t byte_idx = page_idx / 8;
-	uint8_t bit_idx = page_idx % 8;
-	return (pmm_bitmap[byte_idx] & (1 << bit_idx)) != 0;
-}
-
-static uint32_t pmm_find_free_pages(uint32_t pages) {
-	if (pages == 0 || pages > total_pages) {
-		return 0xFFFFFFFF;
-	}
-
-	uint32_t consecutive = 0;
-	for (uint32_t i = 0; i < total_pages; i++) {
-		if (!pmm_test_bit(i)) {
-			consecutive++;
-			if (consecutive == pages) {
-				return i - pages + 1;
-			}
-		} else {
-			consecutive = 0;
-		}
-	}
-	return 0xFFFFFFFF;
-}
-
-void pmm_init(multiboot_info_t *mb_info, uint32_t kernel_end) {
-	if (!(mb_info->flags & (1 << 6))) {
-		printf("PMM: Memory map not provided!\n");
-		while (1) { hlt(); }
-	}
-
-	uint32_t bitmap_addr = PAGE_ALIGN(kernel_end);
-	memory_base = 0xFFFFFFFF;
-	uint64_t total_memory = 0;
-
-	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t *)mb_info->mmap_addr;
-	uint32_t mmap_end = mb_info->mmap_addr + mb_info->mmap_length;
-
-	while ((uint32_t)mmap < mmap_end) {
-		if (mmap->type == MULTIBOOT_MEMORY_AVAILABLE) {
-			uint32_t base = mmap->base_addr_low;
-			uint32_t length = mmap->length_low;
-
-			if (base < bitmap_addr) {
-				if (base + length <= bitmap_addr) {
-					goto next_entry;
-				}
-				length -= (bitmap_addr - base);
-				base = bitmap_addr;
-			}
-
-			if (base < memory_base) {
-				memory_base = base;
-			}
-			total_memory += length;
-		}
-next_entry:
-		mmap = (multiboot_mmap_entry_t *)((uint32_t)mmap + mmap->size + sizeof(mmap->size));
-	}
-
-	total_pages = total_memory / PAGE_SIZE;
-	bitmap_size = (total_pages + 7) / 8; // Округляем вверх до байта
-	free_pages = total_pages;
-
-	pmm_bitmap = (uint8_t *)bitmap_addr;
-	memset(pmm_bitmap, 0, bitmap_size);
-
-	uint32_t kernel_pages = (bitmap_addr - memory_base) / PAGE_SIZE + (bitmap_size + PAGE_SIZE - 1) / PAGE_SIZE;
-	for (uint32_t i = 0; i < kernel_pages; i++) {
-		pmm_set_bit(i);
-		free_pages--;
-	}
-
-	printf("PMM: Initialized with %d total pages, %d free, bitmap at 0x%x, size %d bytes\n",
-			total_pages, free_pages, bitmap_addr, bitmap_size);
-}
-
-void *pmm_alloc(uint32_t pages) {
-	if (pages == 0 || pages > free_pages) {
-		printf("PMM: Not enough pages (%d requested, %d free)\n", pages, free_pages);
-		return NULL;
-    }
-
-	uint32_t start_idx = pmm_find_free_pages(pages);
-	if (start_idx == 0xFFFFFFFF) {
-		printf("PMM: No contiguous %d pages available\n", pages);
-		return NULL;
-	}
-
-	for (uint32_t i = 0; i < pages; i++) {
-		pmm_set_bit(start_idx + i);
-	}
-	free_pages -= pages;
-
-	void *addr = (void *)(memory_base + start_idx * PAGE_SIZE);
-	printf("PMM: Allocated %d pages at 0x%x\n", pages, (uint32_t)addr);
-	return addr;
-}
-
-void pmm_free(void *addr, uint32_t pages) {
-	if (addr == NULL || pages == 0) {
-		printf("PMM: Invalid free request (addr=0x%x, pages=%d)\n", (uint32_t)addr, pages);
-		return;
-	}
-
-	uint32_t start_idx = ((uint32_t)addr - memory_base) / PAGE_SIZE;
-	if ((uint32_t)addr < memory_base || start_idx + pages > total_pages) {
-		printf("PMM: Invalid address 0x%x for free\n", (uint32_t)addr);
-		return;
-	}
-
-	for (uint32_t i = 0; i < pages; i++) {
-		if (!pmm_test_bit(start_idx + i)) {
-			printf("PMM: Page %d at 0x%x was not allocated\n", start_idx + i, (uint32_t)addr + i * PAGE_SIZE);
-			return;
-		}
-	}
-
-	for (uint32_t i = 0; i < pages; i++) {
-		pmm_clear_bit(start_idx + i);
-	}
-	free_pages += pages;
-
-	printf("PMM: Freed %d pages at 0x%x\n", pages, (uint32_t)addr);
-}
-
-uint32_t pmm_get_total_pages(void) {
-	return total_pages;
-}
-
-uint32_t pmm_get_free_pages(void) {
-	return free_pages;
+#include <pmm.h>
+#include <list.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <spinlock.h>
+#include <timer.h>
+#include <task.h>
+#include <klog.h>
+#include <fpu.h>
+
+#define PMM_FRAME_FREE 0x01
+
+typedef struct pmm_frame {
+	list_head_t list;
+	uint8_t order;
+	uint8_t flags;
+	uint8_t owner;
+	void *data;
+} pmm_frame_t;
+
+typedef struct pmm_region {
+	uint32_t base_pfn;
+	uint32_t pages;
+	uint32_t free_pages;
+	uint32_t free_mask;
+	pmm_frame_t *frames;
+	list_head_t free_lists[PMM_MAX_ORDER];
+} pmm_region_t;
+
+static pmm_region_t regions[PMM_MAX_REGIONS];
+static uint32_t region_count = 0;
+static pmm_high_region_t high_regions[PMM_MAX_REGIONS];
+static uint32_t high_region_count = 0;
+static uint64_t high_pages = 0;
+static uint32_t frames_size = 0;
+static uint32_t total_pages = 0;
+static uint32_t free_pages = 0;
+static void *zero_pool[PMM_ZERO_POOL_SIZE];
+static uint32_t zero_pool_count = 0;
+static uint32_t stat_allocs = 0;
+static uint32_t stat_frees = 0;
+static uint32_t stat_failed = 0;
+static uint32_t stat_peak_used = 0;
+// Общая для всех CPU, поэтому MCS: ждущие крутятся каждый на своём узле
+static mcs_lock_t pmm_lock = MCS_LOCK_INIT;
+
+static uint32_t pmm_order_for(uint32_t pages) {
+	uint32_t order = 0;
+	while ((1u << order) < pages) {
+		order++;
+	}
+	return order;
+}
+
+static inline pmm_frame_t *pmm_frame(pmm_region_t *region, uint32_t pfn) {
+	return &region->frames[pfn - region->base_pfn];
+}
+
+static void pmm_push_block(pmm_region_t *region, uint32_t pfn, uint32_t order) {
+	pmm_frame_t *frame = pmm_frame(region, pfn);
+	frame->order = order;
+	frame->flags |= PMM_FRAME_FREE;
+	list_add(&frame->list, &region->free_lists[order]);
+	region->free_mask |= 1u << order;
+}
+
+static void pmm_pop_block(pmm_region_t *region, uint32_t pfn) {
+	pmm_frame_t *frame = pmm_frame(region, pfn);
+	list_del(&frame->list);
+	frame->flags &= ~PMM_FRAME_FREE;
+	if (list_empty(&region->free_lists[frame->order])) {
+		region->free_mask &= ~(1u << frame->order);
+	}
+}
+
+// Регионы отсортированы по base_pfn, поэтому поиск двоичный
+static pmm_region_t *pmm_find_region(uint32_t pfn) {
+	uint32_t lo = 0;
+	uint32_t hi = region_count;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		pmm_region_t *region = &regions[mid];
+		if (pfn < region->base_pfn) {
+			hi = mid;
+		} else if (pfn >= region->base_pfn + region->pages) {
+			lo = mid + 1;
+		} else {
+			return region;
+		}
+	}
+	return NULL;
+}
+
+// Страница внутри свободного блока: ищем голову блока среди предков
+static int pmm_frame_is_free(pmm_region_t *region, uint32_t pfn) {
+	for (uint32_t order = 0; order < PMM_MAX_ORDER; order++) {
+		uint32_t head = pfn & ~((1u << order) - 1);
+		if (head < region->base_pfn) {
+			break;
+		}
+		pmm_frame_t *frame = pmm_frame(region, head);
+		if ((frame->flags & PMM_FRAME_FREE) && frame->order >= order) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void pmm_free_block(pmm_region_t *region, uint32_t pfn, uint32_t order) {
+	uint32_t end_pfn = region->base_pfn + region->pages;
+	while (order < PMM_MAX_ORDER - 1) {
+		uint32_t buddy = pfn ^ (1u << order);
+		if (buddy < region->base_pfn || buddy + (1u << order) > end_pfn) {
+			break;
+		}
+		pmm_frame_t *frame = pmm_frame(region, buddy);
+		if (!(frame->flags & PMM_FRAME_FREE) || frame->order != order) {
+			break;
+		}
+		pmm_pop_block(region, buddy);
+		pfn &= ~(1u << order);
+		order++;
+	}
+	pmm_push_block(region, pfn, order);
+}
+
+// Раскладываем диапазон на максимальные выровненные блоки
+static void pmm_free_range(pmm_region_t *region, uint32_t pfn, uint32_t pages) {
+	region->free_pages += pages;
+	while (pages) {
+		uint32_t order = 0;
+		while (order < PMM_MAX_ORDER - 1 &&
+			!(pfn & (1u << order)) && (2u << order) <= pages) {
+			order++;
+		}
+		pmm_free_block(region, pfn, order);
+		pfn += 1u << order;
+		pages -= 1u << order;
+	}
+}
+
+static void pmm_add_high_region(uint64_t base, uint64_t end) {
+	// После выравнивания от региона короче страницы ничего не остаётся
+	if (base >= end) {
+		return;
+	}
+	if (high_region_count == PMM_MAX_REGIONS) {
+		printf("PMM: Too many high memory regions, ignoring 0x%x%08x\n",
+				(uint32_t)(base >> 32), (uint32_t)base);
+		return;
+	}
+	pmm_high_region_t *high = &high_regions[high_region_count++];
+	high->base = base;
+	high->pages = (end - base) / PAGE_SIZE;
+	high_pages += high->pages;
+}
+
+static void pmm_add_region(uint32_t base_pfn, uint32_t pages) {
+	if (region_count == PMM_MAX_REGIONS) {
+		printf("PMM: Too many memory regions, ignoring 0x%x\n", base_pfn * PAGE_SIZE);
+		return;
+	}
+
+	uint32_t i = region_count++;
+	while (i > 0 && regions[i - 1].base_pfn > base_pfn) {
+		regions[i] = regions[i - 1];
+		i--;
+	}
+	regions[i].base_pfn = base_pfn;
+	regions[i].pages = pages;
+}
+
+static void pmm_scan_mmap(multiboot_info_t *mb_info, uint32_t low_limit) {
+	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t *)mb_info->mmap_addr;
+	uint32_t mmap_end = mb_info->mmap_addr + mb_info->mmap_length;
+
+	region_count = 0;
+	high_region_count = 0;
+	high_pages = 0;
+
+	while ((uint32_t)mmap < mmap_end) {
+		if (mmap->type == MULTIBOOT_MEMORY_AVAILABLE) {
+			uint64_t base = ((uint64_t)mmap->base_addr_high << 32) | mmap->base_addr_low;
+			uint64_t end = base + (((uint64_t)mmap->length_high << 32) | mmap->length_low);
+
+			base = (base + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+			end &= ~(uint64_t)(PAGE_SIZE - 1);
+			if (base < low_limit) {
+				base = low_limit;
+			}
+
+			if (end > PMM_LOW_LIMIT) {
+				pmm_add_high_region(base > PMM_LOW_LIMIT ? base : PMM_LOW_LIMIT, end);
+				end = PMM_LOW_LIMIT;
+			}
+			if (base < end) {
+				pmm_add_region(base / PAGE_SIZE, (end - base) / PAGE_SIZE);
+			}
+		}
+		mmap = (multiboot_mmap_entry_t *)((uint32_t)mmap + mmap->size + sizeof(mmap->size));
+	}
+}
+
+void pmm_init(multiboot_info_t *mb_info, uint32_t kernel_end) {
+	if (!(mb_info->flags & (1 << 6))) {
+		printf("PMM: Memory map not provided!\n");
+		while (1) { hlt(); }
+	}
+
+	uint32_t frames_addr = PAGE_ALIGN(kernel_end);
+	pmm_scan_mmap(mb_info, frames_addr);
+
+	frames_size = 0;
+	for (uint32_t i = 0; i < region_count; i++) {
+		frames_size += regions[i].pages * sizeof(pmm_frame_t);
+	}
+	if (!pmm_find_region(frames_addr / PAGE_SIZE)) {
+		printf("PMM: No usable memory after the kernel at 0x%x!\n", frames_addr);
+		while (1) { hlt(); }
+	}
+
+	// Дескрипторы кадров лежат сразу за ядром, остальное отдаём аллокатору
+	pmm_scan_mmap(mb_info, PAGE_ALIGN(frames_addr + frames_size));
+
+	pmm_frame_t *frames = (pmm_frame_t *)frames_addr;
+	total_pages = 0;
+	free_pages = 0;
+	for (uint32_t i = 0; i < region_count; i++) {
+		pmm_region_t *region = &regions[i];
+		region->frames = frames;
+		region->free_pages = 0;
+		region->free_mask = 0;
+		frames += region->pages;
+		memset(region->frames, 0, region->pages * sizeof(pmm_frame_t));
+		for (uint32_t order = 0; order < PMM_MAX_ORDER; order++) {
+			list_init(&region->free_lists[order]);
+		}
+
+		pmm_free_range(region, region->base_pfn, region->pages);
+		total_pages += region->pages;
+		free_pages += region->pages;
+	}
+
+	printf("PMM: Initialized with %d total pages in %d regions, %d free, frame map at 0x%x, size %d bytes\n",
+			total_pages, region_count, free_pages, frames_addr, frames_size);
+	if (high_pages) {
+		printf("PMM: %d pages above 4 GiB in %d regions reserved for later use\n",
+				(uint32_t)high_pages, high_region_count);
+	}
+}
+
+static void pmm_account_take(uint32_t pages) {
+	free_pages -= pages;
+	if (total_pages - free_pages - zero_pool_count > stat_peak_used) {
+		stat_peak_used = total_pages - free_pages - zero_pool_count;
+	}
+}
+
+// Больше максимального блока: ищем подряд идущие свободные блоки
+// старшего порядка, хвост последнего возвращаем
+static void *pmm_take_large(uint32_t pages) {
+	uint32_t block = 1u << (PMM_MAX_ORDER - 1);
+	uint32_t need = (pages + block - 1) / block;
+	for (uint32_t i = 0; i < region_count; i++) {
+		pmm_region_t *region = &regions[i];
+		uint32_t end_pfn = region->base_pfn + region->pages;
+		uint32_t run = 0;
+		for (uint32_t pfn = (region->base_pfn + block - 1) & ~(block - 1); pfn + block <= end_pfn; pfn += block) {
+			pmm_frame_t *frame = pmm_frame(region, pfn);
+			if (!(frame->flags & PMM_FRAME_FREE) || frame->order != PMM_MAX_ORDER - 1) {
+				run = 0;
+				continue;
+			}
+			if (++run < need) {
+				continue;
+			}
+
+			uint32_t first = pfn - (need - 1) * block;
+			for (uint32_t j = 0; j < need; j++) {
+				pmm_pop_block(region, first + j * block);
+			}
+			region->free_pages -= need * block;
+			if (pages < need * block) {
+				pmm_free_range(region, first + pages, need * block - pages);
+			}
+			pmm_account_take(pages);
+			return (void *)(first * PAGE_SIZE);
+		}
+	}
+	return NULL;
+}
+
+static void *pmm_take(uint32_t pages) {
+	uint32_t order = pmm_order_for(pages);
+	if (order >= PMM_MAX_ORDER) {
+		return pmm_take_large(pages);
+	}
+
+	pmm_region_t *region = NULL;
+	uint32_t avail = 0;
+	for (uint32_t i = 0; i < region_count; i++) {
+		avail = regions[i].free_mask >> order;
+		if (avail) {
+			region = &regions[i];
+			break;
+		}
+	}
+	if (!region) {
+		return NULL;
+	}
+
+	uint32_t found = order + __builtin_ctz(avail);
+	pmm_frame_t *frame = list_entry(region->free_lists[found].next, pmm_frame_t, list);
+	uint32_t pfn = region->base_pfn + (frame - region->frames);
+	pmm_pop_block(region, pfn);
+
+	while (found > order) {
+		found--;
+		pmm_push_block(region, pfn + (1u << found), found);
+	}
+	if (pages < (1u << order)) {
+		pmm_free_range(region, pfn + pages, (1u << order) - pages);
+	}
+	region->free_pages -= 1u << order;
+	pmm_account_take(pages);
+
+	return (void *)(pfn * PAGE_SIZE);
+}
+
+static void pmm_put(void *addr, uint32_t pages) {
+	uint32_t pfn = (uint32_t)addr / PAGE_SIZE;
+	pmm_free_range(pmm_find_region(pfn), pfn, pages);
+	free_pages += pages;
+}
+
+// Под давлением памяти обнулённые страницы возвращаются в общий пул
+static void pmm_zero_pool_drain(void) {
+	while (zero_pool_count) {
+		pmm_put(zero_pool[--zero_pool_count], 1);
+	}
+}
+
+void *pmm_alloc(uint32_t pages) {
+	mcs_node_t node;
+	uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+	if (pages == 0 || pages > free_pages + zero_pool_count) {
+		stat_failed++;
+		mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+		klog(KLOG_WARNING, "PMM: Not enough pages (%d requested, %d free)\n", pages, free_pages + zero_pool_count);
+		return NULL;
+	}
+
+	void *addr = pmm_take(pages);
+	if (!addr && zero_pool_count) {
+		pmm_zero_pool_drain();
+		addr = pmm_take(pages);
+	}
+	if (addr) {
+		stat_allocs++;
+	} else {
+		stat_failed++;
+	}
+	mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+
+	if (!addr) {
+		klog(KLOG_WARNING, "PMM: No contiguous %d pages available\n", pages);
+		return NULL;
+	}
+
+	klog(KLOG_DEBUG, "PMM: Allocated %d pages at 0x%x\n", pages, (uint32_t)addr);
+	return addr;
+}
+
+void *pmm_alloc_zeroed(uint32_t pages) {
+	if (pages == 1) {
+		mcs_node_t node;
+		uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+		if (zero_pool_count) {
+			void *addr = zero_pool[--zero_pool_count];
+			stat_allocs++;
+			mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+			return addr;
+		}
+		mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+	}
+
+	void *addr = pmm_alloc(pages);
+	if (addr) {
+		memset(addr, 0, pages * PAGE_SIZE);
+	}
+	return addr;
+}
+
+// Зовётся только из задачи pagezero, поэтому может обнулять через SSE
+int pmm_zero_pool_refill(void) {
+	mcs_node_t node;
+	uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+	if (zero_pool_count >= PMM_ZERO_POOL_SIZE || free_pages <= total_pages / PMM_ZERO_POOL_RESERVE) {
+		mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+		return 0;
+	}
+	void *addr = pmm_take(1);
+	mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+	if (!addr) {
+		return 0;
+	}
+
+	if (fpu_sse_enabled()) {
+		fpu_zero_page(addr);
+	} else {
+		memset(addr, 0, PAGE_SIZE);
+	}
+
+	flags = mcs_lock_irqsave(&pmm_lock, &node);
+	if (zero_pool_count < PMM_ZERO_POOL_SIZE) {
+		zero_pool[zero_pool_count++] = addr;
+		addr = NULL;
+	}
+	if (addr) {
+		pmm_put(addr, 1);
+	}
+	mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+	return 1;
+}
+
+uint32_t pmm_zero_pool_pages(void) {
+	return zero_pool_count;
+}
+
+void pmm_zero_task(void) {
+	while (1) {
+		while (pmm_zero_pool_refill()) {
+			schedule();
+		}
+		sleep(PMM_ZERO_POOL_INTERVAL);
+	}
+}
+
+void pmm_free(void *addr, uint32_t pages) {
+	if (addr == NULL || pages == 0) {
+		klog(KLOG_ERR, "PMM: Invalid free request (addr=0x%x, pages=%d)\n", (uint32_t)addr, pages);
+		return;
+	}
+
+	uint32_t pfn = (uint32_t)addr / PAGE_SIZE;
+	pmm_region_t *region = pmm_find_region(pfn);
+	if (!region || ((uint32_t)addr & (PAGE_SIZE - 1)) ||
+		pfn + pages > region->base_pfn + region->pages) {
+		klog(KLOG_ERR, "PMM: Invalid address 0x%x for free\n", (uint32_t)addr);
+		return;
+	}
+
+	mcs_node_t node;
+	uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+	if (pmm_frame_is_free(region, pfn) || pmm_frame_is_free(region, pfn + pages - 1)) {
+		mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+		klog(KLOG_ERR, "PMM: Pages at 0x%x were not allocated\n", (uint32_t)addr);
+		return;
+	}
+	pmm_put(addr, pages);
+	stat_frees++;
+	mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+
+	klog(KLOG_DEBUG, "PMM: Freed %d pages at 0x%x\n", pages, (uint32_t)addr);
+}
+
+void pmm_set_owner(void *addr, uint32_t pages, uint8_t owner, void *data) {
+	uint32_t pfn = (uint32_t)addr / PAGE_SIZE;
+	pmm_region_t *region = pmm_find_region(pfn);
+	if (!region || pfn + pages > region->base_pfn + region->pages) {
+		printf("PMM: Invalid owner change at 0x%x\n", (uint32_t)addr);
+		return;
+	}
+
+	pmm_frame_t *frame = pmm_frame(region, pfn);
+	for (uint32_t i = 0; i < pages; i++, frame++) {
+		frame->owner = owner;
+		frame->data = data;
+	}
+}
+
+uint8_t pmm_get_owner(const void *addr, void **data) {
+	pmm_region_t *region = pmm_find_region((uint32_t)addr / PAGE_SIZE);
+	if (!region) {
+		return PMM_OWNER_NONE;
+	}
+
+	pmm_frame_t *frame = pmm_frame(region, (uint32_t)addr / PAGE_SIZE);
+	if (data) {
+		*data = frame->data;
+	}
+	return frame->owner;
+}
+
+uint32_t pmm_get_total_pages(void) {
+	return total_pages;
+}
+
+// Конец последнего региона ниже 4 ГБ; регионы отсортированы
+uint64_t pmm_get_max_address(void) {
+	if (!region_count) {
+		return 0;
+	}
+	pmm_region_t *last = &regions[region_count - 1];
+	return ((uint64_t)last->base_pfn + last->pages) * PAGE_SIZE;
+}
+
+uint32_t pmm_get_free_pages(void) {
+	return free_pages + zero_pool_count;
+}
+
+uint64_t pmm_get_high_pages(void) {
+	return high_pages;
+}
+
+uint32_t pmm_get_high_regions(const pmm_high_region_t **out) {
+	*out = high_regions;
+	return high_region_count;
+}
+
+// Внешняя фрагментация видна по разнице между свободными страницами
+// и самым крупным свободным блоком
+void pmm_get_stats(pmm_stats_t *stats) {
+	memset(stats, 0, sizeof(pmm_stats_t));
+
+	mcs_node_t node;
+	uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+	stats->allocs = stat_allocs;
+	stats->frees = stat_frees;
+	stats->failed = stat_failed;
+	stats->free_pages = free_pages;
+	stats->zero_pool_pages = zero_pool_count;
+	stats->used_pages = total_pages - free_pages - zero_pool_count;
+	stats->peak_used_pages = stat_peak_used;
+
+	for (uint32_t i = 0; i < region_count; i++) {
+		for (uint32_t order = 0; order < PMM_MAX_ORDER; order++) {
+			list_head_t *pos;
+			list_for_each(pos, &regions[i].free_lists[order]) {
+				stats->free_blocks[order]++;
+			}
+			if (stats->free_blocks[order] && (1u << order) > stats->largest_free) {
+				stats->largest_free = 1u << order;
+			}
+		}
+	}
+	mcs_unlock_irqrestore(&pmm_lock, &node, flags);
 }
\ No newline at end of file
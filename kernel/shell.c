@@ -1,253 +1,502 @@
-#include <shell.h>
-#include <lib/stdio.h>
-#include <lib/string.h>
-#include <x86.h>
-#include <speaker.h>
-#include <pmm.h>
-#include <kheap.h>
-#include <timer.h>
-#include <keyboard.h>
-#include <panic.h>
-#include <task.h>
-#include <sync.h>
-
-static multiboot_info_t *global_mb_info;
-static char *cmd_buffer;
-static size_t cmd_len = 0;
-static mutex_t vga_mutex;
-
-static void print_memory_map(multiboot_info_t *mb_info) {
-	if (!mb_info || !(mb_info->flags & (1 << 6))) {
-		mutex_lock(&vga_mutex);
-		printf("Memory map not provided or invalid mb_info!\n");
-		mutex_unlock(&vga_mutex);
-		return;
-    }
-
-	mutex_lock(&vga_mutex);
-	printf("Memory map provided by bootloader:\n");
-	printf("mmap_addr = 0x%x, mmap_length = %d bytes\n", mb_info->mmap_addr, mb_info->mmap_length);
-	mutex_unlock(&vga_mutex);
-
-	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t *)mb_info->mmap_addr;
-	uint64_t total_available = 0;
-
-	for (uint32_t i = 0; (uint32_t)mmap < (mb_info->mmap_addr + mb_info->mmap_length); i++) {
-		mutex_lock(&vga_mutex);
-		printf("Region %d: ", i);
-		printf("Base: 0x%x%08x, ", mmap->base_addr_high, mmap->base_addr_low);
-		printf("Length: 0x%x%08x, ", mmap->length_high, mmap->length_low);
-        
-		switch (mmap->type) {
-			case MULTIBOOT_MEMORY_AVAILABLE:
-				printf("Type: Available\n");
-				total_available += ((uint64_t)mmap->length_high << 32) | mmap->length_low;
-				break;
-			case MULTIBOOT_MEMORY_RESERVED:
-				printf("Type: Reserved\n");
-				break;
-			default:
-				printf("Type: Unknown (%d)\n", mmap->type);
-				break;
-		}
-		mutex_unlock(&vga_mutex);
-		mmap = (multiboot_mmap_entry_t *)((uint32_t)mmap + mmap->size + sizeof(mmap->size));
-	}
-	mutex_lock(&vga_mutex);
-	printf("Total available memory: %d KB\n", (uint32_t)(total_available / 1024));
-	mutex_unlock(&vga_mutex);
-}
-
-static void shell_execute(char *cmd) {
-	char *args[3] = {0};
-	int arg_count = 0;
-	char *token = cmd;
-
-	while (*cmd && arg_count < 3) {
-		if (*cmd == ' ') {
-			*cmd = '\0';
-			if (token[0]) {
-				args[arg_count++] = token;
-			}
-			token = cmd + 1;
-		}
-		cmd++;
-	}
-	if (token[0]) {
-		args[arg_count++] = token;
-	}
-
-	if (args[0] == 0) {
-		return;
-	}
-
-	mutex_lock(&vga_mutex);
-	if (strcmp(args[0], "exit") == 0) {
-		printf("Shutting down...\n");
-		mutex_unlock(&vga_mutex);
-		while (1) { hlt(); }
-	}
-	else if (strcmp(args[0], "beep") == 0) {
-		uint32_t freq = 440;
-		uint32_t duration = 200;
-		if (arg_count > 1) freq = atoi(args[1]);
-		if (arg_count > 2) duration = atoi(args[2]);
-		mutex_unlock(&vga_mutex);
-		speaker_beep(freq, duration);
-	}
-	else if (strcmp(args[0], "mem") == 0) {
-		mutex_unlock(&vga_mutex);
-		if (!global_mb_info) {
-			mutex_lock(&vga_mutex);
-			printf("Error: multiboot info not available!\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		print_memory_map(global_mb_info);
-		mutex_lock(&vga_mutex);
-		printf("PMM: Total pages: %d, Free pages: %d\n", pmm_get_total_pages(), pmm_get_free_pages());
-		mutex_unlock(&vga_mutex);
-	}
-	else if (strcmp(args[0], "clear") == 0) {
-		clear_screen();
-		mutex_unlock(&vga_mutex);
-	}
-	else if (strcmp(args[0], "alloc") == 0) {
-		if (arg_count < 2) {
-			printf("Usage: alloc <bytes>\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		size_t bytes = atoi(args[1]);
-		mutex_unlock(&vga_mutex);
-		void *ptr = kmalloc(bytes);
-		mutex_lock(&vga_mutex);
-		if (ptr) {
-			printf("Allocated %d bytes at 0x%x\n", bytes, (uint32_t)ptr);
-		} else {
-			printf("Failed to allocate %d bytes\n", bytes);
-		}
-		mutex_unlock(&vga_mutex);
-	}
-	else if (strcmp(args[0], "free") == 0) {
-		if (arg_count < 2) {
-			printf("Usage: free <address>\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		uint32_t addr = atox(args[1]);
-		mutex_unlock(&vga_mutex);
-		kfree((void *)addr);
-	}
-	else if (strcmp(args[0], "write") == 0) {
-		if (arg_count < 3) {
-			printf("Usage: write <address> <text>\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		uint32_t addr = atox(args[1]);
-		size_t len = strlen(args[2]);
-		mutex_unlock(&vga_mutex);
-		int written = kwrite((void *)addr, args[2], len + 1);
-		mutex_lock(&vga_mutex);
-		if (written > 0) {
-			printf("Wrote %d bytes ('%s') to 0x%x\n", written, args[2], addr);
-		} else {
-			printf("Failed to write to 0x%x\n", addr);
-		}
-		mutex_unlock(&vga_mutex);
-	}
-	else if (strcmp(args[0], "read") == 0) {
-		if (arg_count < 3) {
-			printf("Usage: read <address> <symbols count>\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		uint32_t addr = atox(args[1]);
-		int count = atoi(args[2]);
-		if (count <= 0 || count > 256) {
-			printf("Invalid count: must be between 1 and 256\n");
-			mutex_unlock(&vga_mutex);
-			return;
-		}
-		char *data = (char *)addr;
-		printf("Read %d symbols from 0x%x: '", count, addr);
-		for (int i = 0; i < count && data[i] != '\0'; i++) {
-			putchar(data[i]);
-		}
-		printf("'\n");
-		mutex_unlock(&vga_mutex);
-	}
-	else if (strcmp(args[0], "yield") == 0) {
-		printf("Yielding to next task...\n");
-		mutex_unlock(&vga_mutex);
-		schedule();
-	}
-	else if (strcmp(args[0], "help") == 0) {
-		printf("Commands:\n");
-		printf("  exit - Shut down the kernel\n");
-		printf("  beep [freq] [duration] - Beep at freq Hz for duration ms\n");
-		printf("  mem - Show memory map and PMM status\n");
-		printf("  clear - Clear the screen\n");
-		printf("  alloc <bytes> - Allocate specified number of bytes\n");
-		printf("  free <address> - Free memory at specified address (hex)\n");
-		printf("  write <address> <text> - Write text to specified address (hex)\n");
-		printf("  read <address> <symbols count> - Read count symbols from address (hex)\n");
-		printf("  yield - Switch to the next task\n");
-		printf("  help - Show this help\n");
-		mutex_unlock(&vga_mutex);
-	}
-	else {
-		printf("Unknown command: %s\n", args[0]);
-		mutex_unlock(&vga_mutex);
-	}
-}
-
-void shell_init(multiboot_info_t *mb_info) {
-	global_mb_info = mb_info;
-
-	cmd_buffer = kmalloc(256);
-	if (!cmd_buffer) {
-		panic_custom("Failed to allocate command buffer");
-	}
-
-	mutex_init(&vga_mutex);
-}
-
-void shell_run(void) {
-	mutex_lock(&vga_mutex);
-	printf("Welcome to KillFence Kernel with Multitasking!\n");
-	mutex_unlock(&vga_mutex);
-
-	while (1) {
-		mutex_lock(&vga_mutex);
-		printf("> ");
-		mutex_unlock(&vga_mutex);
-		cmd_len = 0;
-		while (1) {
-			char c = keyboard_getc();
-			
-			mutex_lock(&vga_mutex);
-			if (c == '\n') {
-				putchar('\n');
-				cmd_buffer[cmd_len] = '\0';
-				mutex_unlock(&vga_mutex);
-				shell_execute(cmd_buffer);
-				break;
-			} else if (c == '\b') {
-				if (cmd_len > 0) {
-					cmd_len--;
-					putchar('\b');
-					putchar(' ');
-					putchar('\b');
-				}
-			} else if (cmd_len < 255) {
-				cmd_buffer[cmd_len++] = c;
-				putchar(c);
-			}
-			mutex_unlock(&vga_mutex);
-		}
-	}
-
-	kfree(cmd_buffer);
+#include <shell.h>
+#include <lib/stdio.h>
+#include <lib/string.h>
+#include <x86.h>
+#include <speaker.h>
+#include <pmm.h>
+#include <kheap.h>
+#include <timer.h>
+#include <keyboard.h>
+#include <panic.h>
+#include <task.h>
+#include <sync.h>
+#include <klog.h>
+#include <smp.h>
+#include <clocksource.h>
+
+static multiboot_info_t *global_mb_info;
+static char *cmd_buffer;
+static size_t cmd_len = 0;
+static mutex_t vga_mutex;
+
+#define TOP_MAX_TASKS 32
+#define TOP_DEFAULT_INTERVAL_MS 1000
+#define TOP_POLL_MS 50
+
+typedef struct {
+	thread_control_block_t *task;
+	char name[32];
+	uint8_t state;
+	uint8_t priority;
+	uint8_t policy;
+	uint32_t cpu;
+	task_stats_t stats;
+} top_entry_t;
+
+static top_entry_t top_now[TOP_MAX_TASKS];
+static top_entry_t top_prev[TOP_MAX_TASKS];
+static const char *top_states[] = { "run", "ready", "block", "dead" };
+
+static void print_memory_map(multiboot_info_t *mb_info) {
+	if (!mb_info || !(mb_info->flags & (1 << 6))) {
+		mutex_lock(&vga_mutex);
+		printf("Memory map not provided or invalid mb_info!\n");
+		mutex_unlock(&vga_mutex);
+		return;
+    }
+
+	mutex_lock(&vga_mutex);
+	printf("Memory map provided by bootloader:\n");
+	printf("mmap_addr = 0x%x, mmap_length = %d bytes\n", mb_info->mmap_addr, mb_info->mmap_length);
+	mutex_unlock(&vga_mutex);
+
+	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t *)mb_info->mmap_addr;
+	uint64_t total_available = 0;
+
+	for (uint32_t i = 0; (uint32_t)mmap < (mb_info->mmap_addr + mb_info->mmap_length); i++) {
+		mutex_lock(&vga_mutex);
+		printf("Region %d: ", i);
+		printf("Base: 0x%x%08x, ", mmap->base_addr_high, mmap->base_addr_low);
+		printf("Length: 0x%x%08x, ", mmap->length_high, mmap->length_low);
+        
+		switch (mmap->type) {
+			case MULTIBOOT_MEMORY_AVAILABLE:
+				printf("Type: Available\n");
+				total_available += ((uint64_t)mmap->length_high << 32) | mmap->length_low;
+				break;
+			case MULTIBOOT_MEMORY_RESERVED:
+				printf("Type: Reserved\n");
+				break;
+			default:
+				printf("Type: Unknown (%d)\n", mmap->type);
+				break;
+		}
+		mutex_unlock(&vga_mutex);
+		mmap = (multiboot_mmap_entry_t *)((uint32_t)mmap + mmap->size + sizeof(mmap->size));
+	}
+	mutex_lock(&vga_mutex);
+	printf("Total available memory: %d KB\n", (uint32_t)(total_available / 1024));
+	mutex_unlock(&vga_mutex);
+}
+
+static uint32_t percent_of(uint32_t part, uint32_t total) {
+	if (!total) {
+		return 0;
+	}
+	return total > 1000000 ? part / (total / 100) : part * 100 / total;
+}
+
+static void print_memstat(void) {
+	pmm_stats_t pmm;
+	kheap_stats_t heap;
+	pmm_get_stats(&pmm);
+	kheap_get_stats(&heap);
+
+	mutex_lock(&vga_mutex);
+	printf("PMM: used %d pages (peak %d), free %d, zero pool %d\n",
+			pmm.used_pages, pmm.peak_used_pages, pmm.free_pages, pmm.zero_pool_pages);
+	printf("PMM: allocs %d, frees %d, failed %d\n", pmm.allocs, pmm.frees, pmm.failed);
+	printf("PMM: largest free block %d pages, fragmentation %d percent\n", pmm.largest_free,
+			100 - percent_of(pmm.largest_free, pmm.free_pages));
+	printf("PMM: free blocks by order:");
+	for (int i = 0; i < PMM_MAX_ORDER; i++) {
+		printf(" %d:%d", i, pmm.free_blocks[i]);
+	}
+	printf("\n");
+
+	printf("Heap: in use %d bytes (peak %d), failed %d\n", heap.bytes_in_use, heap.peak_bytes, heap.failed);
+	printf("Heap: chunk pages held %d, grown %d, returned %d, large pages %d\n",
+			heap.pages_held, heap.pages_grown, heap.pages_returned, heap.large_pages);
+	printf("Heap: free %d bytes in %d blocks, largest %d, fragmentation %d percent\n",
+			heap.free_bytes, heap.free_blocks, heap.largest_free,
+			100 - percent_of(heap.largest_free, heap.free_bytes));
+	printf("Heap: allocs/frees by class:\n");
+	for (int i = 0; i < KHEAP_CLASSES; i++) {
+		if (i < KMALLOC_CLASSES) {
+			printf("  %d: %d/%d", KMALLOC_MIN_SIZE << i, heap.allocs[i], heap.frees[i]);
+		} else if (i == KHEAP_CLASS_BLOCK) {
+			printf("  block: %d/%d", heap.allocs[i], heap.frees[i]);
+		} else {
+			printf("  large: %d/%d", heap.allocs[i], heap.frees[i]);
+		}
+		if (i % 4 == 3 || i == KHEAP_CLASSES - 1) {
+			printf("\n");
+		}
+	}
+	printf("Heap: request size histogram (up to N bytes):\n");
+	for (int i = 0; i < KHEAP_HIST_BUCKETS; i++) {
+		if (i == KHEAP_HIST_BUCKETS - 1) {
+			printf("  more: %d\n", heap.histogram[i]);
+		} else {
+			printf("  %d: %d", 1 << i, heap.histogram[i]);
+		}
+		if (i % 6 == 5) {
+			printf("\n");
+		}
+	}
+
+	const kheap_caller_t *callers;
+	uint32_t slots = kheap_get_callers(&callers);
+	for (uint32_t i = 0; i < slots; i++) {
+		if (callers[i].caller) {
+			printf("Heap: caller 0x%x: %d allocs, %d bytes\n",
+					(uint32_t)callers[i].caller, callers[i].allocs, callers[i].bytes);
+		}
+	}
+	mutex_unlock(&vga_mutex);
+}
+
+// printf не умеет выравнивание пробелами, поэтому колонки добиваем вручную
+static void top_column(const char *text, int width, int right) {
+	int len = strlen(text);
+	if (right) {
+		for (int i = len; i < width; i++) {
+			putchar(' ');
+		}
+	}
+	printf("%s", text);
+	if (!right) {
+		for (int i = len; i < width; i++) {
+			putchar(' ');
+		}
+	}
+}
+
+static void top_number(uint32_t value, int width) {
+	char buf[12];
+	snprintf(buf, sizeof(buf), "%d", value);
+	top_column(buf, width, 1);
+}
+
+static uint32_t top_snapshot(top_entry_t *entries) {
+	uint32_t count = 0;
+	// Задачи из списка не освобождаются, пока он захвачен
+	uint32_t flags = ticket_lock_irqsave(&task_list_lock);
+	list_head_t *pos;
+	list_for_each(pos, &task_list_head) {
+		if (count == TOP_MAX_TASKS) {
+			break;
+		}
+		thread_control_block_t *task = list_entry(pos, thread_control_block_t, list);
+		top_entry_t *entry = &entries[count++];
+		entry->task = task;
+		memcpy(entry->name, task->name, sizeof(entry->name));
+		entry->state = task->state;
+		entry->priority = task->priority;
+		entry->policy = task->policy;
+		entry->cpu = task->cpu;
+		task_get_stats(task, &entry->stats);
+	}
+	ticket_unlock_irqrestore(&task_list_lock, flags);
+	return count;
+}
+
+static const task_stats_t *top_find_prev(thread_control_block_t *task, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		if (top_prev[i].task == task) {
+			return &top_prev[i].stats;
+		}
+	}
+	return NULL;
+}
+
+static void top_print(uint32_t count, uint32_t prev_count, uint32_t elapsed_us, uint32_t interval_ms) {
+	uint32_t latency[TASK_LATENCY_BUCKETS] = {0};
+
+	mutex_lock(&vga_mutex);
+	clear_screen();
+	printf("top - uptime %d s, %d CPU(s), %d tasks, refresh %d ms, any key to quit\n",
+			(uint32_t)div64_32(ktime_get_ns(), NSEC_PER_MSEC * 1000), smp_cpu_count, count, interval_ms);
+	// Знак процента printf не поддерживает, поэтому заголовок идёт аргументом
+	printf("%s\n", "NAME          ST     PR CPU %CPU  RUN ms  RDY ms    VOL    INV  AVGus   MAXus");
+
+	for (uint32_t i = 0; i < count; i++) {
+		top_entry_t *entry = &top_now[i];
+		const task_stats_t *prev = top_find_prev(entry->task, prev_count);
+		uint64_t ran = prev ? entry->stats.run_ns - prev->run_ns : 0;
+		uint32_t dispatches = 0;
+		for (int b = 0; b < TASK_LATENCY_BUCKETS; b++) {
+			dispatches += entry->stats.latency[b];
+			latency[b] += entry->stats.latency[b];
+		}
+
+		char name[14];
+		strncpy(name, entry->name, sizeof(name) - 1);
+		name[sizeof(name) - 1] = '\0';
+		top_column(name, 14, 0);
+		top_column(entry->state < 4 ? top_states[entry->state] : "?", 6, 0);
+		if (entry->policy == TASK_POLICY_EDF) {
+			top_column("rt", 3, 1);
+		} else {
+			top_number(entry->priority, 3);
+		}
+		top_number(entry->cpu, 4);
+		top_number(elapsed_us ? (uint32_t)div64_32(div64_32(ran, NSEC_PER_USEC) * 100, elapsed_us) : 0, 5);
+		top_number((uint32_t)div64_32(entry->stats.run_ns, NSEC_PER_MSEC), 8);
+		top_number((uint32_t)div64_32(entry->stats.ready_ns, NSEC_PER_MSEC), 8);
+		top_number(entry->stats.voluntary, 7);
+		top_number(entry->stats.involuntary, 7);
+		top_number(dispatches ? (uint32_t)div64_32(div64_32(entry->stats.ready_ns, NSEC_PER_USEC), dispatches) : 0, 7);
+		top_number(entry->stats.max_latency_us, 8);
+		printf("\n");
+	}
+
+	printf("Scheduling latency (all tasks):\n");
+	for (int b = 0; b < TASK_LATENCY_BUCKETS; b++) {
+		if (b == TASK_LATENCY_BUCKETS - 1) {
+			printf("  >=%dus: %d\n", 1 << (b - 1), latency[b]);
+		} else {
+			printf("  <%dus: %d", 1 << b, latency[b]);
+		}
+		if (b % 5 == 4) {
+			printf("\n");
+		}
+	}
+	mutex_unlock(&vga_mutex);
+}
+
+// Обновляет таблицу раз в interval_ms до нажатия клавиши; %CPU считается
+// по приросту времени работы между двумя снимками
+static void shell_top(uint32_t interval_ms) {
+	uint32_t prev_count = top_snapshot(top_prev);
+	uint64_t prev_time = ktime_get_ns();
+
+	while (1) {
+		for (uint32_t waited = 0; waited < interval_ms; waited += TOP_POLL_MS) {
+			if (keyboard_trygetc()) {
+				return;
+			}
+			sleep(TOP_POLL_MS);
+		}
+
+		uint32_t count = top_snapshot(top_now);
+		uint64_t now = ktime_get_ns();
+		top_print(count, prev_count, (uint32_t)div64_32(now - prev_time, NSEC_PER_USEC), interval_ms);
+
+		memcpy(top_prev, top_now, count * sizeof(top_entry_t));
+		prev_count = count;
+		prev_time = now;
+	}
+}
+
+static void shell_execute(char *cmd) {
+	char *args[3] = {0};
+	int arg_count = 0;
+	char *token = cmd;
+
+	while (*cmd && arg_count < 3) {
+		if (*cmd == ' ') {
+			*cmd = '\0';
+			if (token[0]) {
+				args[arg_count++] = token;
+			}
+			token = cmd + 1;
+		}
+		cmd++;
+	}
+	if (token[0]) {
+		args[arg_count++] = token;
+	}
+
+	if (args[0] == 0) {
+		return;
+	}
+
+	mutex_lock(&vga_mutex);
+	if (strcmp(args[0], "exit") == 0) {
+		printf("Shutting down...\n");
+		mutex_unlock(&vga_mutex);
+		while (1) { hlt(); }
+	}
+	else if (strcmp(args[0], "beep") == 0) {
+		uint32_t freq = 440;
+		uint32_t duration = 200;
+		if (arg_count > 1) freq = atoi(args[1]);
+		if (arg_count > 2) duration = atoi(args[2]);
+		mutex_unlock(&vga_mutex);
+		speaker_beep(freq, duration);
+	}
+	else if (strcmp(args[0], "mem") == 0) {
+		mutex_unlock(&vga_mutex);
+		if (!global_mb_info) {
+			mutex_lock(&vga_mutex);
+			printf("Error: multiboot info not available!\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		print_memory_map(global_mb_info);
+		mutex_lock(&vga_mutex);
+		printf("PMM: Total pages: %d, Free pages: %d, High pages: %d\n", pmm_get_total_pages(), pmm_get_free_pages(),
+				(uint32_t)pmm_get_high_pages());
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "memstat") == 0) {
+		mutex_unlock(&vga_mutex);
+		print_memstat();
+	}
+	else if (strcmp(args[0], "dmesg") == 0) {
+		klog_dump();
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "loglevel") == 0) {
+		if (arg_count > 1) {
+			klog_set_level(atoi(args[1]));
+		}
+		printf("Log level: %d (0 - emerg .. 7 - debug)\n", klog_get_level());
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "clear") == 0) {
+		clear_screen();
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "alloc") == 0) {
+		if (arg_count < 2) {
+			printf("Usage: alloc <bytes>\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		size_t bytes = atoi(args[1]);
+		mutex_unlock(&vga_mutex);
+		void *ptr = kmalloc(bytes);
+		mutex_lock(&vga_mutex);
+		if (ptr) {
+			printf("Allocated %d bytes at 0x%x\n", bytes, (uint32_t)ptr);
+		} else {
+			printf("Failed to allocate %d bytes\n", bytes);
+		}
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "free") == 0) {
+		if (arg_count < 2) {
+			printf("Usage: free <address>\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		uint32_t addr = atox(args[1]);
+		mutex_unlock(&vga_mutex);
+		kfree((void *)addr);
+	}
+	else if (strcmp(args[0], "write") == 0) {
+		if (arg_count < 3) {
+			printf("Usage: write <address> <text>\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		uint32_t addr = atox(args[1]);
+		size_t len = strlen(args[2]);
+		mutex_unlock(&vga_mutex);
+		int written = kwrite((void *)addr, args[2], len + 1);
+		mutex_lock(&vga_mutex);
+		if (written > 0) {
+			printf("Wrote %d bytes ('%s') to 0x%x\n", written, args[2], addr);
+		} else {
+			printf("Failed to write to 0x%x\n", addr);
+		}
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "read") == 0) {
+		if (arg_count < 3) {
+			printf("Usage: read <address> <symbols count>\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		uint32_t addr = atox(args[1]);
+		int count = atoi(args[2]);
+		if (count <= 0 || count > 256) {
+			printf("Invalid count: must be between 1 and 256\n");
+			mutex_unlock(&vga_mutex);
+			return;
+		}
+		char *data = (char *)addr;
+		printf("Read %d symbols from 0x%x: '", count, addr);
+		for (int i = 0; i < count && data[i] != '\0'; i++) {
+			putchar(data[i]);
+		}
+		printf("'\n");
+		mutex_unlock(&vga_mutex);
+	}
+	else if (strcmp(args[0], "top") == 0) {
+		uint32_t interval = TOP_DEFAULT_INTERVAL_MS;
+		if (arg_count > 1 && atoi(args[1]) > 0) {
+			interval = atoi(args[1]);
+		}
+		mutex_unlock(&vga_mutex);
+		shell_top(interval);
+	}
+	else if (strcmp(args[0], "yield") == 0) {
+		printf("Yielding to next task...\n");
+		mutex_unlock(&vga_mutex);
+		schedule();
+	}
+	else if (strcmp(args[0], "help") == 0) {
+		printf("Commands:\n");
+		printf("  exit - Shut down the kernel\n");
+		printf("  beep [freq] [duration] - Beep at freq Hz for duration ms\n");
+		printf("  mem - Show memory map and PMM status\n");
+		printf("  memstat - Show heap and PMM statistics\n");
+		printf("  dmesg - Show the kernel log buffer\n");
+		printf("  loglevel [level] - Show or set the kernel log level\n");
+		printf("  clear - Clear the screen\n");
+		printf("  alloc <bytes> - Allocate specified number of bytes\n");
+		printf("  free <address> - Free memory at specified address (hex)\n");
+		printf("  write <address> <text> - Write text to specified address (hex)\n");
+		printf("  read <address> <symbols count> - Read count symbols from address (hex)\n");
+		printf("  top [interval ms] - Show per-task scheduler statistics until a key is pressed\n");
+		printf("  yield - Switch to the next task\n");
+		printf("  help - Show this help\n");
+		mutex_unlock(&vga_mutex);
+	}
+	else {
+		printf("Unknown command: %s\n", args[0]);
+		mutex_unlock(&vga_mutex);
+	}
+}
+
+void shell_init(multiboot_info_t *mb_info) {
+	global_mb_info = mb_info;
+
+	cmd_buffer = kmalloc(256);
+	if (!cmd_buffer) {
+		panic_custom("Failed to allocate command buffer");
+	}
+
+	mutex_init(&vga_mutex);
+}
+
+void shell_run(void) {
+	mutex_lock(&vga_mutex);
+	printf("Welcome to KillFence Kernel with Multitasking!\n");
+	mutex_unlock(&vga_mutex);
+
+	while (1) {
+		mutex_lock(&vga_mutex);
+		printf("> ");
+		mutex_unlock(&vga_mutex);
+		cmd_len = 0;
+		while (1) {
+			char c = keyboard_getc();
+			
+			mutex_lock(&vga_mutex);
+			if (c == '\n') {
+				putchar('\n');
+				cmd_buffer[cmd_len] = '\0';
+				mutex_unlock(&vga_mutex);
+				shell_execute(cmd_buffer);
+				break;
+			} else if (c == '\b') {
+				if (cmd_len > 0) {
+					cmd_len--;
+					putchar('\b');
+					putchar(' ');
+					putchar('\b');
+				}
+			} else if (cmd_len < 255) {
+				cmd_buffer[cmd_len++] = c;
+				putchar(c);
+			}
+			mutex_unlock(&vga_mutex);
+		}
+	}
+
+	kfree(cmd_buffer);
 }
\ No newline at end of file
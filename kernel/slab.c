@@ -0,0 +1,254 @@
+#include <slab.h>
+#include <pmm.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <spinlock.h>
+#include <panic.h>
+
+#define SLAB_MAX_PAGES 8
+#define SLAB_MAX_EMPTY 1
+
+static kmem_cache_t cache_cache;
+static kmem_cache_t kmalloc_caches[KMALLOC_CLASSES];
+static LIST_HEAD(cache_list);
+static spinlock_t cache_list_lock = SPINLOCK_INIT;
+
+static const char *kmalloc_names[KMALLOC_CLASSES] = {
+	"kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+	"kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048"
+};
+
+static size_t slab_align_up(size_t value, size_t align) {
+	return (value + align - 1) & ~(align - 1);
+}
+
+static void kmem_cache_setup(kmem_cache_t *cache, const char *name, size_t size, size_t align) {
+	if (align == 0) {
+		align = SLAB_CACHE_LINE;
+		while (align / 2 >= size && align > sizeof(void *)) {
+			align /= 2;
+		}
+	}
+	if (align < sizeof(void *)) {
+		align = sizeof(void *);
+	}
+
+	memset(cache, 0, sizeof(kmem_cache_t));
+	cache->magic = SLAB_MAGIC;
+	strncpy(cache->name, name, sizeof(cache->name) - 1);
+	cache->object_size = size;
+	cache->align = align;
+	cache->size = slab_align_up(size < sizeof(void *) ? sizeof(void *) : size, align);
+	cache->offset = slab_align_up(sizeof(slab_t), align);
+
+	// Растём до тех пор, пока потери на хвосте не станут меньше 1/8 слаба
+	for (cache->slab_pages = 1; ; cache->slab_pages *= 2) {
+		uint32_t bytes = cache->slab_pages * PAGE_SIZE;
+		if (bytes > cache->offset + cache->size) {
+			cache->objects_per_slab = (bytes - cache->offset) / cache->size;
+			uint32_t waste = bytes - cache->objects_per_slab * cache->size;
+			if (waste * 8 <= bytes || cache->slab_pages == SLAB_MAX_PAGES) {
+				break;
+			}
+		} else if (cache->slab_pages == SLAB_MAX_PAGES) {
+			break;
+		}
+	}
+
+	list_init(&cache->partial);
+	list_init(&cache->full);
+	list_init(&cache->empty);
+	spin_lock_init(&cache->lock);
+
+	uint32_t flags = spin_lock_irqsave(&cache_list_lock);
+	list_add_tail(&cache->list, &cache_list);
+	spin_unlock_irqrestore(&cache_list_lock, flags);
+}
+
+static slab_t *slab_grow(kmem_cache_t *cache) {
+	void *pages = pmm_alloc(cache->slab_pages);
+	if (!pages) {
+		return NULL;
+	}
+
+	slab_t *slab = (slab_t *)pages;
+	slab->cache = cache;
+	slab->inuse = 0;
+	slab->free = NULL;
+
+	uint8_t *obj = (uint8_t *)pages + cache->offset + (cache->objects_per_slab - 1) * cache->size;
+	for (uint32_t i = 0; i < cache->objects_per_slab; i++, obj -= cache->size) {
+		*(void **)obj = slab->free;
+		slab->free = obj;
+	}
+
+	pmm_set_owner(pages, cache->slab_pages, PMM_OWNER_SLAB, slab);
+	cache->total_objects += cache->objects_per_slab;
+	return slab;
+}
+
+static void slab_release(kmem_cache_t *cache, slab_t *slab) {
+	cache->total_objects -= cache->objects_per_slab;
+	pmm_set_owner(slab, cache->slab_pages, PMM_OWNER_NONE, NULL);
+	pmm_free(slab, cache->slab_pages);
+}
+
+void slab_init(void) {
+	list_init(&cache_list);
+	kmem_cache_setup(&cache_cache, "kmem_cache", sizeof(kmem_cache_t), 0);
+
+	size_t size = KMALLOC_MIN_SIZE;
+	for (int i = 0; i < KMALLOC_CLASSES; i++, size *= 2) {
+		kmem_cache_setup(&kmalloc_caches[i], kmalloc_names[i], size, size);
+	}
+
+	printf("Slab: Initialized %d kmalloc caches (%d..%d bytes)\n",
+			KMALLOC_CLASSES, KMALLOC_MIN_SIZE, KMALLOC_MAX_SIZE);
+}
+
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align) {
+	if (!name || size == 0 || size > SLAB_MAX_PAGES * PAGE_SIZE / 2 || (align & (align - 1))) {
+		printf("Slab: Invalid cache parameters (size=%d, align=%d)\n", size, align);
+		return NULL;
+	}
+
+	kmem_cache_t *cache = kmem_cache_alloc(&cache_cache);
+	if (!cache) {
+		return NULL;
+	}
+
+	kmem_cache_setup(cache, name, size, align);
+
+	printf("Slab: Created cache '%s' (object %d, stride %d, %d per %d-page slab)\n",
+			cache->name, cache->object_size, cache->size, cache->objects_per_slab, cache->slab_pages);
+	return cache;
+}
+
+void kmem_cache_destroy(kmem_cache_t *cache) {
+	if (!cache || cache->magic != SLAB_MAGIC) {
+		printf("Slab: Invalid cache 0x%x for destroy\n", (uint32_t)cache);
+		return;
+	}
+	if (cache->active_objects) {
+		printf("Slab: Cache '%s' still has %d objects in use\n", cache->name, cache->active_objects);
+		return;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&cache_list_lock);
+	list_del(&cache->list);
+	spin_unlock(&cache_list_lock);
+
+	spin_lock(&cache->lock);
+	while (!list_empty(&cache->empty)) {
+		slab_t *slab = list_entry(cache->empty.next, slab_t, list);
+		list_del(&slab->list);
+		slab_release(cache, slab);
+	}
+	cache->magic = 0;
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	kmem_cache_free(&cache_cache, cache);
+}
+
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+	if (!cache || cache->magic != SLAB_MAGIC) {
+		printf("Slab: Invalid cache 0x%x for alloc\n", (uint32_t)cache);
+		return NULL;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&cache->lock);
+	slab_t *slab;
+	if (!list_empty(&cache->partial)) {
+		slab = list_entry(cache->partial.next, slab_t, list);
+	} else if (!list_empty(&cache->empty)) {
+		slab = list_entry(cache->empty.next, slab_t, list);
+		list_del(&slab->list);
+		list_add(&slab->list, &cache->partial);
+		cache->empty_count--;
+	} else {
+		slab = slab_grow(cache);
+		if (!slab) {
+			spin_unlock_irqrestore(&cache->lock, flags);
+			printf("Slab: Out of memory for cache '%s'\n", cache->name);
+			return NULL;
+		}
+		list_add(&slab->list, &cache->partial);
+	}
+
+	void *obj = slab->free;
+	slab->free = *(void **)obj;
+	slab->inuse++;
+	cache->active_objects++;
+	if (slab->inuse == cache->objects_per_slab) {
+		list_del(&slab->list);
+		list_add(&slab->list, &cache->full);
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	return obj;
+}
+
+int kmalloc_index(kmem_cache_t *cache) {
+	if (cache < kmalloc_caches || cache >= kmalloc_caches + KMALLOC_CLASSES) {
+		return -1;
+	}
+	return cache - kmalloc_caches;
+}
+
+slab_t *slab_of(const void *obj) {
+	void *data;
+	if (pmm_get_owner(obj, &data) != PMM_OWNER_SLAB) {
+		return NULL;
+	}
+	return (slab_t *)data;
+}
+
+int slab_object_valid(slab_t *slab, const void *obj) {
+	kmem_cache_t *cache = slab->cache;
+	uint32_t offset = (const uint8_t *)obj - (const uint8_t *)slab;
+	return offset >= cache->offset && (offset - cache->offset) % cache->size == 0 &&
+		(offset - cache->offset) / cache->size < cache->objects_per_slab;
+}
+
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+	if (!obj) {
+		return;
+	}
+
+	slab_t *slab = slab_of(obj);
+	if (!slab || slab->cache != cache || !slab_object_valid(slab, obj)) {
+		printf("Slab: Invalid free of 0x%x to cache '%s'\n", (uint32_t)obj, cache ? cache->name : "?");
+		return;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&cache->lock);
+	*(void **)obj = slab->free;
+	slab->free = obj;
+	cache->active_objects--;
+
+	if (slab->inuse-- == cache->objects_per_slab) {
+		list_del(&slab->list);
+		list_add(&slab->list, &cache->partial);
+	}
+	if (slab->inuse == 0) {
+		list_del(&slab->list);
+		if (cache->empty_count < SLAB_MAX_EMPTY) {
+			list_add(&slab->list, &cache->empty);
+			cache->empty_count++;
+		} else {
+			slab_release(cache, slab);
+		}
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+kmem_cache_t *kmalloc_slab(size_t size) {
+	if (size == 0 || size > KMALLOC_MAX_SIZE) {
+		return NULL;
+	}
+	if (size <= KMALLOC_MIN_SIZE) {
+		return &kmalloc_caches[0];
+	}
+	return &kmalloc_caches[32 - __builtin_clz(size - 1) - 4];
+}
\ No newline at end of file
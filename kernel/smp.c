@@ -0,0 +1,230 @@
+#include <smp.h>
+#include <apic.h>
+#include <gdt.h>
+#include <interrupts.h>
+#include <pmm.h>
+#include <timer.h>
+#include <clocksource.h>
+#include <vmm.h>
+#include <fpu.h>
+#include <softirq.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <panic.h>
+
+cpu_t cpus[SMP_MAX_CPUS];
+volatile uint32_t smp_cpu_count = 1;
+
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_trampoline_args[];
+
+// Процессор, который сейчас поднимается, и вершина его стека;
+// AP стартуют по одному
+static volatile uint32_t smp_booting_cpu = 0;
+static volatile uint32_t smp_booting_stack = 0;
+
+// Текущий запрос на сброс TLB и маска процессоров, ещё не ответивших на него
+static spinlock_t tlb_lock = SPINLOCK_INIT;
+static volatile uint32_t tlb_start = 0;
+static volatile uint32_t tlb_pages = 0;
+static volatile uint32_t tlb_pending = 0;
+
+_Static_assert(offsetof(cpu_t, current) == CPU_CURRENT_OFFSET, "cpu_t.current offset");
+
+static void smp_cpu_setup(cpu_t *cpu, uint32_t id) {
+	memset(cpu, 0, sizeof(cpu_t));
+	cpu->self = cpu;
+	cpu->id = id;
+	run_queue_init(&cpu->rq);
+	list_init(&cpu->tasklets);
+}
+
+// Сегмент %gs с базой на cpu_t текущего процессора
+static void smp_load_percpu(cpu_t *cpu) {
+	uint16_t selector = (GDT_PERCPU_BASE + cpu->id) << 3;
+	gdt_set_gate(GDT_PERCPU_BASE + cpu->id, (uint32_t)cpu, sizeof(cpu_t) - 1, 0x92, 0x40);
+	asm volatile ("mov %0, %%gs" : : "r"(selector));
+}
+
+void smp_init_bsp(void) {
+	smp_cpu_setup(&cpus[0], 0);
+	smp_load_percpu(&cpus[0]);
+	cpus[0].online = 1;
+}
+
+static void smp_idle(void) {
+	while (1) {
+		schedule();
+		do_softirq();
+		cli();
+		if (!task_ready_pending() && !softirq_pending()) {
+			asm volatile ("sti; hlt");
+		}
+		sti();
+	}
+}
+
+static void smp_ap_main(void) {
+	cpu_t *cpu = &cpus[smp_booting_cpu];
+	uint32_t stack_top = smp_booting_stack;
+
+	vmm_load();
+	gdt_load();
+	smp_load_percpu(cpu);
+	idt_load();
+	fpu_init_cpu();
+	lapic_enable();
+
+	cpu->tss = tss_create(0x10, stack_top, 0, 0, 0, 0, GDT_TSS_BASE + cpu->id);
+	char name[16];
+	snprintf(name, sizeof(name), "idle%d", cpu->id);
+	task_create_idle(name, (void *)stack_top);
+	lapic_timer_start();
+
+	__sync_synchronize();
+	cpu->online = 1;
+	sti();
+	smp_idle();
+}
+
+static int smp_boot_ap(uint8_t apic_id) {
+	uint32_t id = smp_cpu_count;
+	void *stack = pmm_alloc(SMP_AP_STACK_PAGES);
+	if (!stack) {
+		printf("SMP: No memory for CPU %d stack\n", id);
+		return -1;
+	}
+
+	cpu_t *cpu = &cpus[id];
+	smp_cpu_setup(cpu, id);
+	cpu->apic_id = apic_id;
+
+	smp_trampoline_args_t *args = (smp_trampoline_args_t *)(SMP_TRAMPOLINE + (smp_trampoline_args - smp_trampoline_start));
+	args->stack = (uint32_t)stack + SMP_AP_STACK_PAGES * PAGE_SIZE;
+	args->entry = (uint32_t)smp_ap_main;
+	smp_booting_cpu = id;
+	smp_booting_stack = args->stack;
+	smp_cpu_count = id + 1;
+	__sync_synchronize();
+
+	// INIT, затем дважды STARTUP с номером страницы трамплина
+	lapic_send_ipi(apic_id, LAPIC_ICR_INIT);
+	udelay(10000);
+	for (int i = 0; i < 2; i++) {
+		lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE >> 12));
+		udelay(200);
+	}
+
+	for (uint32_t waited = 0; !cpu->online && waited < SMP_AP_TIMEOUT_MS * 10; waited++) {
+		udelay(100);
+	}
+	if (!cpu->online) {
+		printf("SMP: CPU %d (APIC %d) did not start\n", id, apic_id);
+		smp_cpu_count = id;
+		// Стек не освобождаем: процессор мог всё-таки проснуться
+		return -1;
+	}
+	return 0;
+}
+
+void smp_init(void) {
+	cpus[0].apic_id = apic_enabled() ? lapic_id() : 0;
+	if (!apic_enabled() || apic_cpu_count < 2 || !clocksource_get()) {
+		printf("SMP: Running on a single CPU\n");
+		return;
+	}
+
+	memcpy((void *)SMP_TRAMPOLINE, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+	for (uint32_t i = 0; i < apic_cpu_count && smp_cpu_count < SMP_MAX_CPUS; i++) {
+		if (apic_cpu_ids[i] != cpus[0].apic_id) {
+			smp_boot_ap(apic_cpu_ids[i]);
+		}
+	}
+
+	printf("SMP: %d CPU(s) online\n", smp_cpu_count);
+}
+
+void smp_send_reschedule(cpu_t *cpu) {
+	if (cpu->online && cpu != this_cpu()) {
+		lapic_send_ipi(cpu->apic_id, IPI_RESCHEDULE_VECTOR);
+	}
+}
+
+// Зовём один простаивающий процессор, чтобы он забрал работу у except
+void smp_kick_idle(cpu_t *except) {
+	for (uint32_t i = 0; i < smp_cpu_count; i++) {
+		cpu_t *cpu = &cpus[i];
+		if (cpu != except && cpu->online && cpu->current == cpu->idle && !run_queue_busy(&cpu->rq)) {
+			smp_send_reschedule(cpu);
+			return;
+		}
+	}
+}
+
+int smp_others_idle(void) {
+	cpu_t *self = this_cpu();
+	for (uint32_t i = 0; i < smp_cpu_count; i++) {
+		cpu_t *cpu = &cpus[i];
+		if (cpu != self && cpu->online && (cpu->current != cpu->idle || run_queue_busy(&cpu->rq))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void ipi_reschedule_handler(void) {
+	this_cpu()->need_resched = 1;
+	irq_exit();
+}
+
+void ipi_tlb_handler(void) {
+	uint32_t bit = 1u << this_cpu()->id;
+	if (tlb_pending & bit) {
+		vmm_flush_range(tlb_start, tlb_pages);
+		__sync_fetch_and_and(&tlb_pending, ~bit);
+	}
+}
+
+// Ждущий ответа процессор сам обслуживает чужие запросы, поэтому два
+// встречных сброса не блокируют друг друга. Вызывать без других спинлоков:
+// процессор, крутящийся на них с запрещёнными прерываниями, не ответит
+void smp_tlb_shootdown(uint32_t start, uint32_t pages) {
+	if (smp_cpu_count < 2) {
+		return;
+	}
+
+	uint32_t flags = irq_save();
+	while (!spin_trylock(&tlb_lock)) {
+		ipi_tlb_handler();
+		cpu_relax();
+	}
+
+	cpu_t *self = this_cpu();
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < smp_cpu_count; i++) {
+		if (&cpus[i] != self && cpus[i].online) {
+			mask |= 1u << i;
+		}
+	}
+
+	if (mask) {
+		tlb_start = start;
+		tlb_pages = pages;
+		__sync_synchronize();
+		tlb_pending = mask;
+		for (uint32_t i = 0; i < smp_cpu_count; i++) {
+			if (mask & (1u << i)) {
+				lapic_send_ipi(cpus[i].apic_id, IPI_TLB_VECTOR);
+			}
+		}
+		while (tlb_pending) {
+			cpu_relax();
+		}
+	}
+
+	spin_unlock(&tlb_lock);
+	irq_restore(flags);
+}
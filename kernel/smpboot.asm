@@ -0,0 +1,54 @@
+; Трамплин AP: копируется на SMP_TRAMPOLINE (smp.h) и стартует в реальном
+; режиме по STARTUP IPI. Включает защищённый режим с плоскими сегментами,
+; берёт стек и точку входа из smp_trampoline_args
+%define TRAMPOLINE_BASE 0x8000
+%define TRAMP(label) (TRAMPOLINE_BASE + (label) - smp_trampoline_start)
+
+section .text
+global smp_trampoline_start
+global smp_trampoline_end
+global smp_trampoline_args
+
+bits 16
+smp_trampoline_start:
+	cli
+	cld
+	xor ax, ax
+	mov ds, ax
+	lgdt [TRAMP(tramp_gdt_ptr)]
+	mov eax, cr0
+	or eax, 1
+	mov cr0, eax
+	jmp dword 0x08:TRAMP(tramp_protected)
+
+bits 32
+tramp_protected:
+	mov ax, 0x10
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+	mov esp, [TRAMP(smp_trampoline_args)]
+	mov eax, [TRAMP(smp_trampoline_args) + 4]
+	call eax
+tramp_hang:
+	hlt
+	jmp tramp_hang
+
+align 8
+tramp_gdt:
+	dq 0
+	dq 0x00CF9A000000FFFF
+	dq 0x00CF92000000FFFF
+tramp_gdt_ptr:
+	dw tramp_gdt_ptr - tramp_gdt - 1
+	dd TRAMP(tramp_gdt)
+
+align 4
+smp_trampoline_args:
+	dd 0	; стек
+	dd 0	; точка входа
+smp_trampoline_end:
+
+section .note.GNU-stack noalloc noexec nowrite progbits
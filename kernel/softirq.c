@@ -0,0 +1,133 @@
+#include <softirq.h>
+#include <smp.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <task.h>
+#include <timer.h>
+
+static void (*softirq_handlers[SOFTIRQ_COUNT])(void);
+
+void open_softirq(uint32_t nr, void (*handler)(void)) {
+	if (nr >= SOFTIRQ_COUNT) {
+		printf("Softirq: Invalid number %d\n", nr);
+		return;
+	}
+	softirq_handlers[nr] = handler;
+}
+
+// Безопасно вызывать из обработчика прерывания: бит ставится атомарно
+void raise_softirq(uint32_t nr) {
+	__sync_fetch_and_or(&this_cpu()->softirq_pending, 1u << nr);
+}
+
+int softirq_pending(void) {
+	return this_cpu()->softirq_pending != 0;
+}
+
+int in_softirq(void) {
+	return this_cpu()->in_softirq;
+}
+
+// Обработчики работают на стеке прерванной задачи. Пока идёт обработка,
+// вложенные прерывания её не запускают и не зовут schedule(): задача не
+// должна уйти с процессора посреди отложенной работы
+void do_softirq(void) {
+	uint32_t flags = irq_save();
+	cpu_t *cpu = this_cpu();
+	if (cpu->in_softirq) {
+		irq_restore(flags);
+		return;
+	}
+
+	cpu->in_softirq = 1;
+	for (int restart = 0; cpu->softirq_pending && restart < SOFTIRQ_MAX_RESTART; restart++) {
+		uint32_t pending = __sync_lock_test_and_set(&cpu->softirq_pending, 0);
+		sti();
+		while (pending) {
+			uint32_t nr = __builtin_ctz(pending);
+			pending &= pending - 1;
+			if (softirq_handlers[nr]) {
+				softirq_handlers[nr]();
+			}
+		}
+		cli();
+	}
+	cpu->in_softirq = 0;
+	irq_restore(flags);
+}
+
+// Конец аппаратного обработчика: EOI уже отправлен, запускаем отложенную
+// часть и отложенное вытеснение. Вложенное в softirq прерывание только
+// оставляет need_resched, его подхватит внешний irq_exit()
+void irq_exit(void) {
+	cpu_t *cpu = this_cpu();
+	if (cpu->in_softirq) {
+		return;
+	}
+	timer_irq_catchup();
+	if (cpu->softirq_pending) {
+		do_softirq();
+	}
+	if (cpu->need_resched) {
+		schedule();
+	}
+}
+
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *data), void *data) {
+	tasklet->entry.next = NULL;
+	tasklet->entry.prev = NULL;
+	tasklet->state = 0;
+	tasklet->func = func;
+	tasklet->data = data;
+}
+
+// Повторное планирование до запуска ничего не добавляет: функция
+// выполнится один раз
+void tasklet_schedule(tasklet_t *tasklet) {
+	if (__sync_fetch_and_or(&tasklet->state, TASKLET_SCHEDULED) & TASKLET_SCHEDULED) {
+		return;
+	}
+	uint32_t flags = irq_save();
+	list_add_tail(&tasklet->entry, &this_cpu()->tasklets);
+	raise_softirq(SOFTIRQ_TASKLET);
+	irq_restore(flags);
+}
+
+static void tasklet_action(void) {
+	cpu_t *cpu = this_cpu();
+	LIST_HEAD(list);
+
+	cli();
+	if (!list_empty(&cpu->tasklets)) {
+		list.next = cpu->tasklets.next;
+		list.prev = cpu->tasklets.prev;
+		list.next->prev = &list;
+		list.prev->next = &list;
+		list_init(&cpu->tasklets);
+	}
+	sti();
+
+	while (!list_empty(&list)) {
+		tasklet_t *tasklet = list_entry(list.next, tasklet_t, entry);
+		list_del(&tasklet->entry);
+
+		// Один тасклет не выполняется на двух CPU сразу: занятый
+		// другим процессором откладываем до следующего прохода
+		if (__sync_fetch_and_or(&tasklet->state, TASKLET_RUNNING) & TASKLET_RUNNING) {
+			cli();
+			list_add_tail(&tasklet->entry, &cpu->tasklets);
+			raise_softirq(SOFTIRQ_TASKLET);
+			sti();
+			continue;
+		}
+		// Снимаем до вызова, чтобы функция могла запланировать себя снова
+		__sync_fetch_and_and(&tasklet->state, ~TASKLET_SCHEDULED);
+		tasklet->func(tasklet->data);
+		__sync_fetch_and_and(&tasklet->state, ~TASKLET_RUNNING);
+	}
+}
+
+void softirq_init(void) {
+	open_softirq(SOFTIRQ_TASKLET, tasklet_action);
+	printf("Softirq: Initialized %d softirqs\n", SOFTIRQ_COUNT);
+}
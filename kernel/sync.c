@@ -1,106 +1,224 @@
-#include <sync.h>
-#include <kheap.h>
-#include <lib/stdio.h>
-#include <x86.h>
-#include <panic.h>
-
-static inline int test_and_set(uint8_t *lock) {
-	uint8_t old;
-	asm volatile("lock xchg %0, %1" : "=r"(old), "+m"(*lock) : "0"(1) : "memory");
-	return old;
-}
-
-static inline void atomic_inc(uint32_t *value) {
-	asm volatile("lock incl %0" : "+m"(*value));
-}
-
-static inline int atomic_dec(uint32_t *value) {
-	int result;
-	asm volatile("lock decl %0; mov %0, %1" : "+m"(*value), "=r"(result));
-	return result;
-}
-
-void mutex_init(mutex_t *mutex) {
-	if (!mutex) {
-		panic_custom("Mutex init: NULL pointer");
-	}
-	mutex->locked = 0;
-	mutex->owner = NULL;
-	list_init(&mutex->wait_list);
-}
-
-void mutex_lock(mutex_t *mutex) {
-	if (!mutex) {
-		panic_custom("Mutex lock: NULL pointer");
-	}
-
-	while (test_and_set(&mutex->locked)) {
-		if (mutex->owner != current_task_TCB) {
-			current_task_TCB->state = TASK_STATE_BLOCKED;
-			list_add_tail((list_head_t *)current_task_TCB, &mutex->wait_list);
-			schedule();
-		}
-	}
-	mutex->owner = current_task_TCB;
-}
-
-void mutex_unlock(mutex_t *mutex) {
-	if (!mutex) {
-		panic_custom("Mutex unlock: NULL pointer");
-	}
-
-	if (!mutex->locked || mutex->owner != current_task_TCB) {
-		printf("Mutex unlock: Task '%s' does not own mutex 0x%x\n", 
-			current_task_TCB->name, (uint32_t)mutex);
-		return;
-	}
-
-	mutex->locked = 0;
-	mutex->owner = NULL;
-
-	if (!list_empty(&mutex->wait_list)) {
-		thread_control_block_t *next_task = (thread_control_block_t *)mutex->wait_list.next;
-		list_del((list_head_t *)next_task);
-		next_task->state = TASK_STATE_READY;
-	}
-}
-
-void semaphore_init(semaphore_t *sem, uint32_t initial_count, uint32_t max_count) {
-	if (!sem || max_count == 0 || initial_count > max_count) {
-		panic_custom("Semaphore init: Invalid parameters");
-	}
-	sem->count = initial_count;
-	sem->max_count = max_count;
-	list_init(&sem->wait_list);
-}
-
-void semaphore_wait(semaphore_t *sem) {
-	if (!sem) {
-		panic_custom("Semaphore wait: NULL pointer");
-	}
-
-	int count;
-	do {
-		count = atomic_dec(&sem->count);
-		if (count < 0) {
-			current_task_TCB->state = TASK_STATE_BLOCKED;
-			list_add_tail((list_head_t *)current_task_TCB, &sem->wait_list);
-			schedule();
-		}
-	} while (count < 0);
-}
-
-void semaphore_signal(semaphore_t *sem) {
-	if (!sem) {
-		panic_custom("Semaphore signal: NULL pointer");
-	}
-
-	if (sem->count < sem->max_count) {
-		atomic_inc(&sem->count);
-		if (!list_empty(&sem->wait_list)) {
-			thread_control_block_t *next_task = (thread_control_block_t *)sem->wait_list.next;
-			list_del((list_head_t *)next_task);
-			next_task->state = TASK_STATE_READY;
-		}
-	}
-}
\ No newline at end of file
+#include <sync.h>
+#include <smp.h>
+#include <kheap.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <panic.h>
+
+void wait_queue_init(wait_queue_t *wq) {
+	spin_lock_init(&wq->lock);
+	list_init(&wq->waiters);
+}
+
+// Вызывается с захваченным wq->lock и запрещёнными прерываниями и
+// возвращается так же. Задача стоит в очереди, пока спит; если её
+// разбудил не wait_queue_pop(), узел снимаем сами
+void wait_queue_block(wait_queue_t *wq) {
+	thread_control_block_t *task = current_task_TCB;
+	if (!task->wait_list.next) {
+		list_add_tail(&task->wait_list, &wq->waiters);
+	}
+	task->state = TASK_STATE_BLOCKED;
+	// Пробуждение между unlock и schedule() отменит блокировку
+	spin_unlock(&wq->lock);
+	schedule();
+	spin_lock(&wq->lock);
+	if (task->wait_list.next) {
+		list_del(&task->wait_list);
+	}
+}
+
+// Под wq->lock: снимает первую задачу; будить её вызывающий должен
+// после unlock, чтобы не держать очередь вместе с run queue
+thread_control_block_t *wait_queue_pop(wait_queue_t *wq) {
+	if (list_empty(&wq->waiters)) {
+		return NULL;
+	}
+	thread_control_block_t *task = list_entry(wq->waiters.next, thread_control_block_t, wait_list);
+	list_del(&task->wait_list);
+	return task;
+}
+
+int wake_up_one(wait_queue_t *wq) {
+	uint32_t flags = spin_lock_irqsave(&wq->lock);
+	thread_control_block_t *task = wait_queue_pop(wq);
+	spin_unlock_irqrestore(&wq->lock, flags);
+	if (task) {
+		task_wake(task);
+	}
+	return task != NULL;
+}
+
+void wake_up_all(wait_queue_t *wq) {
+	while (wake_up_one(wq)) {
+	}
+}
+
+void mutex_init(mutex_t *mutex) {
+	if (!mutex) {
+		panic_custom("Mutex init: NULL pointer");
+	}
+	mutex->owner = 0;
+	wait_queue_init(&mutex->wait);
+}
+
+// NULL, если мьютекс свободен или захвачен вне задачи
+thread_control_block_t *mutex_owner(mutex_t *mutex) {
+	uint32_t owner = mutex->owner;
+	return (owner & MUTEX_CPU) ? NULL : (thread_control_block_t *)(owner & ~MUTEX_FLAGS);
+}
+
+// Кучей пользуются до появления задач, в том числе AP при запуске, пока
+// BSP уже работает: такой владелец помечается своим cpu_t и не спит
+static uint32_t mutex_self(void) {
+	thread_control_block_t *task = current_task_TCB;
+	return task ? (uint32_t)task : ((uint32_t)this_cpu() | MUTEX_CPU);
+}
+
+// Владелец сейчас выполняется: он скоро отпустит мьютекс, и уснуть
+// дороже, чем подождать. TCB могут освободить, пока мы его читаем, но
+// память slab остаётся отображённой, а ошибка лишь прервёт ожидание
+static int mutex_owner_running(uint32_t owner) {
+	if (owner & MUTEX_CPU) {
+		return 1;
+	}
+	thread_control_block_t *task = (thread_control_block_t *)(owner & ~MUTEX_FLAGS);
+	uint32_t cpu = task->cpu;
+	return cpu < smp_cpu_count && cpus[cpu].current == task;
+}
+
+// Без задачи спать нельзя, поэтому ждём без ограничения
+static int mutex_spin(mutex_t *mutex, uint32_t self) {
+	int can_block = !(self & MUTEX_CPU);
+	if (can_block && smp_cpu_count < 2) {
+		return 0;
+	}
+	for (uint32_t i = 0; !can_block || i < MUTEX_SPIN_LIMIT; i++) {
+		uint32_t owner = mutex->owner;
+		if (!owner) {
+			if (__sync_bool_compare_and_swap(&mutex->owner, 0, self)) {
+				return 1;
+			}
+			continue;
+		}
+		if (can_block && ((owner & MUTEX_WAITERS) || !mutex_owner_running(owner))) {
+			return 0;
+		}
+		cpu_relax();
+	}
+	return 0;
+}
+
+int mutex_trylock(mutex_t *mutex) {
+	return __sync_bool_compare_and_swap(&mutex->owner, 0, mutex_self());
+}
+
+void mutex_lock(mutex_t *mutex) {
+	if (!mutex) {
+		panic_custom("Mutex lock: NULL pointer");
+	}
+
+	uint32_t self = mutex_self();
+	if (__sync_bool_compare_and_swap(&mutex->owner, 0, self)) {
+		return;
+	}
+	if ((mutex->owner & ~MUTEX_WAITERS) == self) {
+		panic_custom("Mutex lock: Recursive locking");
+	}
+	if (mutex_spin(mutex, self)) {
+		return;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&mutex->wait.lock);
+	while (1) {
+		uint32_t owner = mutex->owner;
+		if (!owner) {
+			uint32_t value = self | (list_empty(&mutex->wait.waiters) ? 0 : MUTEX_WAITERS);
+			if (__sync_bool_compare_and_swap(&mutex->owner, 0, value)) {
+				spin_unlock_irqrestore(&mutex->wait.lock, flags);
+				return;
+			}
+			continue;
+		}
+		// С этим битом владелец отпускает мьютекс через очередь
+		if ((owner & MUTEX_WAITERS) || __sync_bool_compare_and_swap(&mutex->owner, owner, owner | MUTEX_WAITERS)) {
+			break;
+		}
+	}
+
+	// mutex_unlock() передаёт мьютекс первому ждущему напрямую,
+	// поэтому после пробуждения захватывать его заново не нужно
+	while ((mutex->owner & ~MUTEX_WAITERS) != self) {
+		wait_queue_block(&mutex->wait);
+	}
+	spin_unlock_irqrestore(&mutex->wait.lock, flags);
+}
+
+void mutex_unlock(mutex_t *mutex) {
+	if (!mutex) {
+		panic_custom("Mutex unlock: NULL pointer");
+	}
+
+	uint32_t self = mutex_self();
+	if ((mutex->owner & ~MUTEX_WAITERS) != self) {
+		printf("Mutex unlock: Mutex 0x%x is not owned by the caller\n", (uint32_t)mutex);
+		return;
+	}
+	if (__sync_bool_compare_and_swap(&mutex->owner, self, 0)) {
+		return;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&mutex->wait.lock);
+	thread_control_block_t *next = wait_queue_pop(&mutex->wait);
+	if (next) {
+		mutex->owner = (uint32_t)next | (list_empty(&mutex->wait.waiters) ? 0 : MUTEX_WAITERS);
+	} else {
+		mutex->owner = 0;
+	}
+	spin_unlock_irqrestore(&mutex->wait.lock, flags);
+
+	if (next) {
+		task_wake(next);
+	}
+}
+
+void semaphore_init(semaphore_t *sem, uint32_t initial_count, uint32_t max_count) {
+	if (!sem || max_count == 0 || initial_count > max_count) {
+		panic_custom("Semaphore init: Invalid parameters");
+	}
+	sem->count = initial_count;
+	sem->max_count = max_count;
+	wait_queue_init(&sem->wait);
+}
+
+void semaphore_wait(semaphore_t *sem) {
+	if (!sem) {
+		panic_custom("Semaphore wait: NULL pointer");
+	}
+
+	uint32_t flags = spin_lock_irqsave(&sem->wait.lock);
+	while (sem->count == 0) {
+		wait_queue_block(&sem->wait);
+	}
+	sem->count--;
+	spin_unlock_irqrestore(&sem->wait.lock, flags);
+}
+
+// Будит одного ждущего: единица счётчика достанется только одной задаче
+void semaphore_signal(semaphore_t *sem) {
+	if (!sem) {
+		panic_custom("Semaphore signal: NULL pointer");
+	}
+
+	uint32_t flags = spin_lock_irqsave(&sem->wait.lock);
+	thread_control_block_t *next = NULL;
+	if (sem->count < sem->max_count) {
+		sem->count++;
+		next = wait_queue_pop(&sem->wait);
+	}
+	spin_unlock_irqrestore(&sem->wait.lock, flags);
+
+	if (next) {
+		task_wake(next);
+	}
+}
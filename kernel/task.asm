@@ -1,30 +1,25 @@
-section .text
-global switch_to_task
-extern current_task_TCB
-extern kernel_tss
-
-switch_to_task:
-	push ebx
-	push esi
-	push edi
-	push ebp
-
-	mov edi, [current_task_TCB]
-	mov [edi + 0], esp
-
-	mov esi, [esp + 20]
-	mov [current_task_TCB], esi
-
-	mov esp, [esi + 0]
-	mov eax, [esi + 4]
-	mov ebx, kernel_tss
-	mov [ebx + 4], eax
-
-	pop ebp
-	pop edi
-	pop esi
-	pop ebx
-
-	ret
-	
-section .note.GNU-stack noalloc noexec nowrite progbits
\ No newline at end of file
+section .text
+global switch_to_task
+
+; switch_to_task(prev, next): сохраняет ESP в prev->esp и продолжает next.
+; current и esp0 в TSS выставляет вызывающий код
+switch_to_task:
+	mov eax, [esp + 4]
+	mov edx, [esp + 8]
+
+	push ebx
+	push esi
+	push edi
+	push ebp
+
+	mov [eax + 0], esp
+	mov esp, [edx + 0]
+
+	pop ebp
+	pop edi
+	pop esi
+	pop ebx
+
+	ret
+	
+section .note.GNU-stack noalloc noexec nowrite progbits
@@ -1,107 +1,726 @@
-#include <task.h>
-#include <kheap.h>
-#include <pmm.h>
-#include <lib/string.h>
-#include <lib/stdio.h>
-#include <x86.h>
-#include <tss.h>
-#include <panic.h>
-#include <sync.h>
-
-thread_control_block_t* current_task_TCB = NULL;
-static thread_control_block_t* task_list_head = NULL;
-
-extern tss_entry_t* kernel_tss;
-
-void initialize_multitasking(void) {
-	thread_control_block_t* initial_task = (thread_control_block_t*)kmalloc(sizeof(thread_control_block_t));
-	if (!initial_task) {
-		panic_custom("Failed to allocate initial task TCB");
-	}
-
-	asm volatile("mov %%esp, %0" : "=r"(initial_task->esp));
-	initial_task->esp0 = (void*)kernel_tss->esp0;
-	initial_task->state = TASK_STATE_RUNNING;
-	initial_task->sleeping = 0;
-	strcpy(initial_task->name, "kernel_main");
-	initial_task->next = initial_task;
-
-	current_task_TCB = initial_task;
-	task_list_head = initial_task;
-
-	printf("Multitasking: Initialized with initial task '%s' (ESP=0x%x, ESP0=0x%x)\n", 
-		   initial_task->name, (uint32_t)initial_task->esp, (uint32_t)initial_task->esp0);
-}
-
-thread_control_block_t* create_kernel_task(void (*entry_point)(void), const char* name) {
-	thread_control_block_t* new_task = (thread_control_block_t*)kmalloc(sizeof(thread_control_block_t));
-	if (!new_task) {
-		panic_custom("Failed to allocate TCB for new task");
-	}
-
-	void* stack = pmm_alloc(4);
-	if (!stack) {
-		kfree(new_task);
-		panic_custom("Failed to allocate stack for new task");
-	}
-	uint32_t stack_top = (uint32_t)stack + 16384;
-
-	new_task->esp0 = (void*)stack_top;
-	new_task->state = TASK_STATE_READY;
-	new_task->sleeping = 0;
-	strncpy(new_task->name, name, 31);
-	new_task->name[31] = '\0';
-
-	uint32_t* stack_ptr = (uint32_t*)stack_top;
-	*--stack_ptr = (uint32_t)entry_point; // EIP
-	*--stack_ptr = 0;
-	*--stack_ptr = 0;
-	*--stack_ptr = 0;
-	*--stack_ptr = 0;
-	new_task->esp = (void*)stack_ptr;
-
-	cli();
-	if (task_list_head) {
-		new_task->next = task_list_head->next;
-		task_list_head->next = new_task;
-		task_list_head = new_task;
-	} else {
-		new_task->next = new_task;
-		task_list_head = new_task;
-	}
-	sti();
-
-	printf("Task: Created '%s' (ESP=0x%x, ESP0=0x%x, Entry=0x%x)\n", 
-		   new_task->name, (uint32_t)new_task->esp, (uint32_t)new_task->esp0, (uint32_t)entry_point);
-
-	return new_task;
-}
-
-void schedule(void) {
-	if (!current_task_TCB || !current_task_TCB->next) {
-		return;
-	}
-
-	thread_control_block_t* next_task = current_task_TCB->next;
-	thread_control_block_t* start = next_task;
-
-	do {
-		if (next_task->state == TASK_STATE_READY) {
-			break;
-		}
-		next_task = next_task->next;
-	} while (next_task != start);
-
-	if (next_task == current_task_TCB || next_task->state != TASK_STATE_READY) {
-		return;
-	}
-
-	cli();
-	if (current_task_TCB->state == TASK_STATE_RUNNING) {
-		current_task_TCB->state = TASK_STATE_READY;
-	}
-	next_task->state = TASK_STATE_RUNNING;
-	sti();
-
-	switch_to_task(next_task);
-}
\ No newline at end of file
+#include <task.h>
+#include <kheap.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <tss.h>
+#include <panic.h>
+#include <sync.h>
+#include <slab.h>
+#include <magazine.h>
+#include <smp.h>
+#include <klog.h>
+#include <fpu.h>
+#include <clocksource.h>
+#include <softirq.h>
+
+LIST_HEAD(task_list_head);
+ticket_lock_t task_list_lock = TICKET_LOCK_INIT;
+static kmem_cache_t* tcb_cache = NULL;
+
+// Вышедшие задачи ждут, пока reaper освободит их стек и TCB
+static LIST_HEAD(reap_list);
+static spinlock_t reap_lock = SPINLOCK_INIT;
+static thread_control_block_t* reaper_task = NULL;
+
+// Готовые стеки, чтобы не ходить в PMM на каждое создание задачи
+static void* stack_cache[TASK_STACK_CACHE];
+static uint32_t stack_cache_count = 0;
+static spinlock_t stack_cache_lock = SPINLOCK_INIT;
+
+static void task_edf_release(void* data);
+
+void run_queue_init(run_queue_t* rq) {
+	spin_lock_init(&rq->lock);
+	for (int i = 0; i < TASK_PRIORITIES; i++) {
+		list_init(&rq->queues[i]);
+	}
+	rq->ready_mask = 0;
+	list_init(&rq->edf_queue);
+	rq->edf_util = 0;
+}
+
+// a срочнее b: EDF раньше обычных, среди EDF - по сроку, иначе по приоритету
+static int task_before(thread_control_block_t* a, thread_control_block_t* b) {
+	if (a->policy != b->policy) {
+		return a->policy == TASK_POLICY_EDF;
+	}
+	if (a->policy == TASK_POLICY_EDF) {
+		return (int64_t)(a->rt.abs_deadline - b->rt.abs_deadline) < 0;
+	}
+	return a->priority < b->priority;
+}
+
+static void run_queue_add(run_queue_t* rq, thread_control_block_t* task) {
+	if (task->policy == TASK_POLICY_EDF) {
+		// Вставка с хвоста: срок новой работы обычно самый поздний
+		list_head_t* pos = rq->edf_queue.prev;
+		while (pos != &rq->edf_queue &&
+			task_before(task, list_entry(pos, thread_control_block_t, run_list))) {
+			pos = pos->prev;
+		}
+		list_add(&task->run_list, pos);
+		return;
+	}
+	list_add_tail(&task->run_list, &rq->queues[task->priority]);
+	rq->ready_mask |= 1u << task->priority;
+}
+
+static void run_queue_del(run_queue_t* rq, thread_control_block_t* task) {
+	list_del(&task->run_list);
+	if (task->policy == TASK_POLICY_NORMAL && list_empty(&rq->queues[task->priority])) {
+		rq->ready_mask &= ~(1u << task->priority);
+	}
+}
+
+static thread_control_block_t* run_queue_pick_normal(run_queue_t* rq) {
+	if (!rq->ready_mask) {
+		return NULL;
+	}
+	uint32_t priority = __builtin_ctz(rq->ready_mask);
+	return list_entry(rq->queues[priority].next, thread_control_block_t, run_list);
+}
+
+static thread_control_block_t* run_queue_pick(run_queue_t* rq) {
+	if (!list_empty(&rq->edf_queue)) {
+		return list_entry(rq->edf_queue.next, thread_control_block_t, run_list);
+	}
+	return run_queue_pick_normal(rq);
+}
+
+// Забираем самую приоритетную задачу у другого CPU. Свою очередь уже
+// держим, чужую берём только trylock, поэтому порядок блокировок не важен.
+// EDF-задачи не переносим: их допуск посчитан для своего процессора
+static thread_control_block_t* run_queue_steal(cpu_t* cpu) {
+	for (uint32_t i = 1; i < smp_cpu_count; i++) {
+		cpu_t* victim = &cpus[(cpu->id + i) % smp_cpu_count];
+		if (!victim->online || !victim->rq.ready_mask || !spin_trylock(&victim->rq.lock)) {
+			continue;
+		}
+
+		thread_control_block_t* task = run_queue_pick_normal(&victim->rq);
+		if (task) {
+			run_queue_del(&victim->rq, task);
+		}
+		spin_unlock(&victim->rq.lock);
+
+		if (task) {
+			task->cpu = cpu->id;
+			run_queue_add(&cpu->rq, task);
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static void* task_stack_alloc(void) {
+	uint32_t flags = spin_lock_irqsave(&stack_cache_lock);
+	if (stack_cache_count) {
+		void* stack = stack_cache[--stack_cache_count];
+		spin_unlock_irqrestore(&stack_cache_lock, flags);
+		return stack;
+	}
+	spin_unlock_irqrestore(&stack_cache_lock, flags);
+	return vmm_alloc(TASK_STACK_PAGES);
+}
+
+static void task_stack_free(void* stack) {
+	uint32_t flags = spin_lock_irqsave(&stack_cache_lock);
+	if (stack_cache_count < TASK_STACK_CACHE) {
+		stack_cache[stack_cache_count++] = stack;
+		stack = NULL;
+	}
+	spin_unlock_irqrestore(&stack_cache_lock, flags);
+	if (stack) {
+		vmm_free(stack, TASK_STACK_PAGES);
+	}
+}
+
+// Новая задача стартует из switch_to_task с запрещёнными прерываниями
+// и захваченной очередью процессора, на котором её запустили
+static void task_start(void (*entry_point)(void)) {
+	spin_unlock(&this_cpu()->rq.lock);
+	sti();
+	entry_point();
+	task_exit(0);
+}
+
+// Стек вышедшей задачи можно отдавать только после того, как её CPU
+// переключился на другую: schedule() держит очередь до конца переключения
+static int task_off_cpu(thread_control_block_t* task) {
+	cpu_t* cpu = &cpus[task->cpu];
+	spin_lock(&cpu->rq.lock);
+	int off = cpu->current != task;
+	spin_unlock(&cpu->rq.lock);
+	return off;
+}
+
+static void reaper(void) {
+	while (1) {
+		uint32_t flags = spin_lock_irqsave(&reap_lock);
+		if (list_empty(&reap_list)) {
+			current_task_TCB->state = TASK_STATE_BLOCKED;
+			spin_unlock(&reap_lock);
+			schedule();
+			irq_restore(flags);
+			continue;
+		}
+
+		thread_control_block_t* task = list_entry(reap_list.next, thread_control_block_t, list);
+		if (!task_off_cpu(task)) {
+			spin_unlock_irqrestore(&reap_lock, flags);
+			schedule();
+			continue;
+		}
+		list_del(&task->list);
+		// До reaped: после него TCB может освободить task_join
+		fpu_free(task);
+		void* stack = task->stack;
+		task->stack = NULL;
+		// Для лога: после reaped TCB трогать нельзя
+		char name[32];
+		strncpy(name, task->name, sizeof(name) - 1);
+		name[sizeof(name) - 1] = '\0';
+		int exit_code = task->exit_code;
+		int joinable = task->flags & TASK_JOINABLE;
+		if (joinable) {
+			task->reaped = 1;
+			if (task->joiner) {
+				task_wake(task->joiner);
+			}
+		}
+		spin_unlock_irqrestore(&reap_lock, flags);
+
+		klog(KLOG_DEBUG, "Task: Reaped '%s' (exit code %d)\n", name, exit_code);
+		task_stack_free(stack);
+		if (!joinable) {
+			kmem_cache_free(tcb_cache, task);
+		}
+	}
+}
+
+void task_exit(int code) {
+	thread_control_block_t* task = current_task_TCB;
+	if (task == this_cpu()->idle) {
+		panic_custom("Idle task tried to exit");
+	}
+
+	// Магазины возвращаем, пока задача ещё текущая: дальше kfree из неё
+	// пойдёт мимо магазинов
+	kmem_magazines_t* mags = task->magazines;
+	task->magazines = NULL;
+	magazine_destroy(mags);
+	task_set_edf(0, 0, 0);
+
+	cli();
+	ticket_lock(&task_list_lock);
+	list_del(&task->list);
+	ticket_unlock(&task_list_lock);
+
+	spin_lock(&reap_lock);
+	task->exit_code = code;
+	task->state = TASK_STATE_DEAD;
+	list_add_tail(&task->list, &reap_list);
+	spin_unlock(&reap_lock);
+
+	task_wake(reaper_task);
+	schedule();
+	panic_custom("Dead task was scheduled");
+	while (1) { hlt(); }
+}
+
+int task_join(thread_control_block_t* task) {
+	if (!task || !(task->flags & TASK_JOINABLE) || task == current_task_TCB) {
+		return -1;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&reap_lock);
+	while (!task->reaped) {
+		task->joiner = current_task_TCB;
+		current_task_TCB->state = TASK_STATE_BLOCKED;
+		spin_unlock(&reap_lock);
+		schedule();
+		spin_lock(&reap_lock);
+	}
+	int code = task->exit_code;
+	spin_unlock_irqrestore(&reap_lock, flags);
+
+	kmem_cache_free(tcb_cache, task);
+	return code;
+}
+
+// Задача простоя процессора из текущего контекста; в очереди не стоит
+thread_control_block_t* task_create_idle(const char* name, void* esp0) {
+	thread_control_block_t* idle = (thread_control_block_t*)kmem_cache_alloc(tcb_cache);
+	if (!idle) {
+		panic_custom("Failed to allocate idle task TCB");
+	}
+
+	cpu_t* cpu = this_cpu();
+	asm volatile("mov %%esp, %0" : "=r"(idle->esp));
+	idle->esp0 = esp0;
+	idle->state = TASK_STATE_RUNNING;
+	idle->priority = TASK_PRIORITY_IDLE;
+	idle->sleeping = 0;
+	idle->wait_list.next = NULL;
+	idle->wait_list.prev = NULL;
+	idle->cpu = cpu->id;
+	idle->stack = NULL;
+	idle->flags = 0;
+	idle->exit_code = 0;
+	idle->reaped = 0;
+	idle->joiner = NULL;
+	idle->data = NULL;
+	idle->fpu = NULL;
+	idle->fpu_cpu = FPU_NO_CPU;
+	memset(&idle->stats, 0, sizeof(task_stats_t));
+	idle->policy = TASK_POLICY_NORMAL;
+	memset(&idle->rt, 0, sizeof(task_rt_t));
+	timer_setup(&idle->rt.timer, task_edf_release, idle);
+	idle->stats.last_run = ktime_get_ns();
+	idle->magazines = magazine_create();
+	strncpy(idle->name, name, 31);
+	idle->name[31] = '\0';
+
+	uint32_t flags = ticket_lock_irqsave(&task_list_lock);
+	list_add_tail(&idle->list, &task_list_head);
+	ticket_unlock_irqrestore(&task_list_lock, flags);
+
+	cpu->idle = idle;
+	cpu->current = idle;
+	return idle;
+}
+
+void initialize_multitasking(void) {
+	tcb_cache = kmem_cache_create("tcb", sizeof(thread_control_block_t), SLAB_CACHE_LINE);
+	if (!tcb_cache) {
+		panic_custom("Failed to create TCB cache");
+	}
+
+	list_init(&task_list_head);
+
+	// kernel_main после инициализации только крутит hlt и служит задачей простоя BSP
+	thread_control_block_t* initial_task = task_create_idle("kernel_main", (void*)this_cpu()->tss->esp0);
+
+	printf("Multitasking: Initialized with initial task '%s' (ESP=0x%x, ESP0=0x%x)\n", 
+		   initial_task->name, (uint32_t)initial_task->esp, (uint32_t)initial_task->esp0);
+
+	for (int i = 0; i < TASK_STACK_CACHE / 2; i++) {
+		void* stack = vmm_alloc(TASK_STACK_PAGES);
+		if (stack) {
+			task_stack_free(stack);
+		}
+	}
+	reaper_task = create_kernel_task(reaper, "reaper");
+}
+
+// Ставит задачу в очередь её процессора под захваченной очередью.
+// Возвращает 1, если задача должна вытеснить текущую
+static int task_enqueue(cpu_t* cpu, thread_control_block_t* task) {
+	task->state = TASK_STATE_READY;
+	task->stats.ready_since = ktime_get_ns();
+	run_queue_add(&cpu->rq, task);
+	return cpu->current == cpu->idle || task_before(task, cpu->current);
+}
+
+// Будим процессор, который должен переключиться; если он занят более
+// важной задачей, зовём простаивающий забрать работу. Свой процессор
+// переключится на выходе из прерывания или в task_wake
+static void task_kick(cpu_t* cpu, int preempt) {
+	if (preempt && cpu == this_cpu()) {
+		cpu->need_resched = 1;
+	} else if (preempt) {
+		smp_send_reschedule(cpu);
+	} else {
+		smp_kick_idle(cpu);
+	}
+}
+
+// После irq_restore(flags) того, кто мог выставить need_resched: из задачи
+// с разрешёнными прерываниями вытесняемся сразу, в прерывании и под
+// спинлоками это сделает irq_exit() или следующий тик
+static void task_preempt_check(uint32_t flags) {
+	if ((flags & EFLAGS_IF) && this_cpu()->need_resched && !in_softirq()) {
+		schedule();
+	}
+}
+
+thread_control_block_t* create_kernel_task(void (*entry_point)(void), const char* name) {
+	return create_kernel_task_flags(entry_point, name, 0);
+}
+
+thread_control_block_t* create_kernel_task_flags(void (*entry_point)(void), const char* name, uint32_t task_flags) {
+	return create_kernel_task_data(entry_point, name, task_flags, NULL);
+}
+
+// data доступен задаче через current_task_TCB->data с первой инструкции
+thread_control_block_t* create_kernel_task_data(void (*entry_point)(void), const char* name, uint32_t task_flags, void* data) {
+	thread_control_block_t* new_task = (thread_control_block_t*)kmem_cache_alloc(tcb_cache);
+	if (!new_task) {
+		panic_custom("Failed to allocate TCB for new task");
+	}
+
+	void* stack = task_stack_alloc();
+	if (!stack) {
+		kmem_cache_free(tcb_cache, new_task);
+		panic_custom("Failed to allocate stack for new task");
+	}
+	uint32_t stack_top = (uint32_t)stack + TASK_STACK_SIZE;
+
+	new_task->esp0 = (void*)stack_top;
+	new_task->state = TASK_STATE_READY;
+	new_task->priority = TASK_PRIORITY_DEFAULT;
+	new_task->sleeping = 0;
+	new_task->wait_list.next = NULL;
+	new_task->wait_list.prev = NULL;
+	new_task->cpu = smp_processor_id();
+	new_task->stack = stack;
+	new_task->flags = task_flags;
+	new_task->exit_code = 0;
+	new_task->reaped = 0;
+	new_task->joiner = NULL;
+	new_task->data = data;
+	new_task->fpu = NULL;
+	new_task->fpu_cpu = FPU_NO_CPU;
+	memset(&new_task->stats, 0, sizeof(task_stats_t));
+	new_task->policy = TASK_POLICY_NORMAL;
+	memset(&new_task->rt, 0, sizeof(task_rt_t));
+	timer_setup(&new_task->rt.timer, task_edf_release, new_task);
+	new_task->magazines = magazine_create();
+	strncpy(new_task->name, name, 31);
+	new_task->name[31] = '\0';
+
+	uint32_t* stack_ptr = (uint32_t*)stack_top;
+	*--stack_ptr = (uint32_t)entry_point;
+	*--stack_ptr = 0;
+	*--stack_ptr = (uint32_t)task_start; // EIP
+	*--stack_ptr = 0;
+	*--stack_ptr = 0;
+	*--stack_ptr = 0;
+	*--stack_ptr = 0;
+	new_task->esp = (void*)stack_ptr;
+
+	uint32_t flags = ticket_lock_irqsave(&task_list_lock);
+	list_add_tail(&new_task->list, &task_list_head);
+	ticket_unlock(&task_list_lock);
+	cpu_t* cpu = &cpus[new_task->cpu];
+	spin_lock(&cpu->rq.lock);
+	int preempt = task_enqueue(cpu, new_task);
+	spin_unlock(&cpu->rq.lock);
+	task_kick(cpu, preempt);
+	irq_restore(flags);
+
+	printf("Task: Created '%s' (ESP=0x%x, ESP0=0x%x, Entry=0x%x)\n", 
+		   new_task->name, (uint32_t)new_task->esp, (uint32_t)new_task->esp0, (uint32_t)entry_point);
+
+	task_preempt_check(flags);
+	return new_task;
+}
+
+static uint32_t task_latency_bucket(uint32_t us) {
+	uint32_t bucket = us ? 32 - __builtin_clz(us) : 0;
+	return bucket < TASK_LATENCY_BUCKETS ? bucket : TASK_LATENCY_BUCKETS - 1;
+}
+
+// Под очередью процессора: prev уходит, next получает CPU. Переключение
+// считается вынужденным, если prev остался готовым
+static void task_account_switch(cpu_t* cpu, thread_control_block_t* prev, thread_control_block_t* next, int preempted) {
+	uint64_t now = ktime_get_ns();
+	prev->stats.run_ns += now - prev->stats.last_run;
+	if (prev->policy == TASK_POLICY_EDF) {
+		prev->rt.budget -= now - prev->stats.last_run;
+	}
+	if (preempted) {
+		prev->stats.involuntary++;
+		prev->stats.ready_since = now;
+	} else {
+		prev->stats.voluntary++;
+	}
+
+	next->stats.last_run = now;
+	if (next == cpu->idle) {
+		return;
+	}
+	uint64_t wait = now - next->stats.ready_since;
+	next->stats.ready_ns += wait;
+	uint64_t wait_us = div64_32(wait, NSEC_PER_USEC);
+	uint32_t us = wait_us >> 32 ? 0xFFFFFFFF : (uint32_t)wait_us;
+	next->stats.latency[task_latency_bucket(us)]++;
+	if (us > next->stats.max_latency_us) {
+		next->stats.max_latency_us = us;
+	}
+}
+
+// Текущая задача в очереди не стоит. Вытесняется она только задачей
+// не ниже своего приоритета; равные чередуются по кругу, а EDF-задачу
+// вытесняет только более ранний срок. Очередь остаётся
+// захваченной на время переключения и отпускается уже в новой задаче:
+// пока ESP старой не сохранён, другой CPU не должен её забрать
+void schedule(void) {
+	if (!current_task_TCB) {
+		return;
+	}
+
+	uint32_t flags = irq_save();
+	cpu_t* cpu = this_cpu();
+	cpu->need_resched = 0;
+	thread_control_block_t* prev = cpu->current;
+	int prev_runnable = prev->state == TASK_STATE_RUNNING && prev != cpu->idle;
+
+	spin_lock(&cpu->rq.lock);
+	thread_control_block_t* next_task = run_queue_pick(&cpu->rq);
+	if (!next_task && !prev_runnable) {
+		next_task = run_queue_steal(cpu);
+	}
+
+	if (prev_runnable) {
+		int keep = !next_task || (prev->policy == TASK_POLICY_EDF ?
+			!task_before(next_task, prev) : task_before(prev, next_task));
+		if (keep) {
+			spin_unlock(&cpu->rq.lock);
+			irq_restore(flags);
+			return;
+		}
+		prev->state = TASK_STATE_READY;
+		run_queue_add(&cpu->rq, prev);
+	}
+
+	if (next_task) {
+		run_queue_del(&cpu->rq, next_task);
+	} else {
+		next_task = cpu->idle;
+	}
+	if (prev == cpu->idle && next_task != prev) {
+		prev->state = TASK_STATE_READY;
+	}
+
+	next_task->state = TASK_STATE_RUNNING;
+	if (next_task != prev) {
+		cpu->current = next_task;
+		cpu->tss->esp0 = (uint32_t)next_task->esp0;
+		task_account_switch(cpu, prev, next_task, prev_runnable);
+		fpu_switch(prev, next_task);
+		switch_to_task(prev, next_task);
+	}
+	spin_unlock(&this_cpu()->rq.lock);
+	irq_restore(flags);
+}
+
+int task_ready_pending(void) {
+	return run_queue_busy(&this_cpu()->rq);
+}
+
+void task_wake(thread_control_block_t* task) {
+	uint32_t flags = irq_save();
+	cpu_t* cpu = &cpus[task->cpu];
+	spin_lock(&cpu->rq.lock);
+	// Урезанную по бюджету EDF-задачу будит только её следующий выпуск
+	if (task->state != TASK_STATE_BLOCKED || task->rt.throttled) {
+		spin_unlock_irqrestore(&cpu->rq.lock, flags);
+		return;
+	}
+	// Задача ещё не успела уйти в schedule() на своём CPU: просто
+	// отменяем блокировку, ставить её в очередь нельзя
+	if (cpu->current == task) {
+		task->state = TASK_STATE_RUNNING;
+		spin_unlock_irqrestore(&cpu->rq.lock, flags);
+		return;
+	}
+	int preempt = task_enqueue(cpu, task);
+	spin_unlock(&cpu->rq.lock);
+	task_kick(cpu, preempt);
+	irq_restore(flags);
+	task_preempt_check(flags);
+}
+
+void task_set_priority(thread_control_block_t* task, uint8_t priority) {
+	if (priority >= TASK_PRIORITIES) {
+		priority = TASK_PRIORITIES - 1;
+	}
+
+	uint32_t flags = irq_save();
+	cpu_t* cpu = &cpus[task->cpu];
+	spin_lock(&cpu->rq.lock);
+	// Готовую задачу могли перетащить на другой CPU, пока мы ждали
+	while (task->cpu != cpu->id) {
+		spin_unlock(&cpu->rq.lock);
+		cpu = &cpus[task->cpu];
+		spin_lock(&cpu->rq.lock);
+	}
+	if (task->state == TASK_STATE_READY) {
+		run_queue_del(&cpu->rq, task);
+		task->priority = priority;
+		run_queue_add(&cpu->rq, task);
+	} else {
+		task->priority = priority;
+	}
+	spin_unlock_irqrestore(&cpu->rq.lock, flags);
+}
+
+// Снимок счётчиков под очередью процессора задачи; текущий квант и
+// текущее ожидание в READY учитываются на момент вызова
+void task_get_stats(thread_control_block_t* task, task_stats_t* stats) {
+	uint32_t flags = irq_save();
+	cpu_t* cpu = &cpus[task->cpu];
+	spin_lock(&cpu->rq.lock);
+	while (task->cpu != cpu->id) {
+		spin_unlock(&cpu->rq.lock);
+		cpu = &cpus[task->cpu];
+		spin_lock(&cpu->rq.lock);
+	}
+	*stats = task->stats;
+	uint64_t now = ktime_get_ns();
+	if (cpu->current == task) {
+		stats->run_ns += now - stats->last_run;
+	} else if (task->state == TASK_STATE_READY) {
+		stats->ready_ns += now - stats->ready_since;
+	}
+	spin_unlock_irqrestore(&cpu->rq.lock, flags);
+}
+
+static uint32_t task_edf_util(uint32_t runtime, uint32_t deadline, uint32_t period) {
+	uint32_t window = deadline < period ? deadline : period;
+	return (uint32_t)div64_32((uint64_t)runtime * EDF_UTIL_SCALE + window - 1, window);
+}
+
+// Выпуск ждём таймером колеса: он срабатывает на тике, не раньше срока
+static void task_edf_arm(thread_control_block_t* task) {
+	uint64_t now = ktime_get_ns();
+	uint32_t tick_ns = NSEC_PER_MSEC * 1000 / system_timer.frequency;
+	uint32_t ticks = 1;
+	if ((int64_t)(task->rt.release - now) > 0) {
+		ticks = (uint32_t)div64_32(task->rt.release - now + tick_ns - 1, tick_ns);
+	}
+	timer_mod(&task->rt.timer, timer_get_ticks() + ticks);
+}
+
+// Начало новой работы: свежий бюджет и срок от момента выпуска
+static void task_edf_release(void* data) {
+	thread_control_block_t* task = (thread_control_block_t*)data;
+	uint32_t flags = irq_save();
+	cpu_t* cpu = &cpus[task->cpu];
+	spin_lock(&cpu->rq.lock);
+	if (task->policy != TASK_POLICY_EDF) {
+		spin_unlock_irqrestore(&cpu->rq.lock, flags);
+		return;
+	}
+	// Работа, урезанная по бюджету, так и не завершилась к сроку
+	if (task->rt.throttled && (int64_t)(ktime_get_ns() - task->rt.abs_deadline) > 0) {
+		task->rt.misses++;
+	}
+	task->rt.abs_deadline = task->rt.release + task->rt.deadline;
+	task->rt.budget = task->rt.runtime;
+	task->rt.throttled = 0;
+	spin_unlock(&cpu->rq.lock);
+	task_wake(task);
+	irq_restore(flags);
+}
+
+// Переводит текущую задачу в класс EDF: runtime мкс работы каждые
+// period мкс, каждая работа должна уложиться в deadline мкс от выпуска.
+// Задача закрепляется за своим процессором, если он проходит допуск.
+// runtime 0 возвращает задачу в обычный класс
+int task_set_edf(uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us) {
+	thread_control_block_t* task = current_task_TCB;
+	if (runtime_us && (runtime_us > deadline_us || deadline_us > period_us || period_us > EDF_MAX_PERIOD_US)) {
+		printf("Task: Invalid EDF parameters %d/%d/%d us for '%s'\n", runtime_us, deadline_us, period_us, task->name);
+		return -1;
+	}
+
+	uint32_t flags = irq_save();
+	cpu_t* cpu = this_cpu();
+	spin_lock(&cpu->rq.lock);
+	if (task->policy == TASK_POLICY_EDF) {
+		cpu->rq.edf_util -= task->rt.util;
+		task->policy = TASK_POLICY_NORMAL;
+	}
+	if (!runtime_us) {
+		spin_unlock_irqrestore(&cpu->rq.lock, flags);
+		// task_exit освободит TCB вместе с таймером: ждём и выпуск,
+		// уже идущий в softirq
+		timer_cancel_sync(&task->rt.timer);
+		return 0;
+	}
+
+	uint32_t util = task_edf_util(runtime_us, deadline_us, period_us);
+	if (cpu->rq.edf_util + util > EDF_UTIL_MAX) {
+		uint32_t used = cpu->rq.edf_util;
+		spin_unlock_irqrestore(&cpu->rq.lock, flags);
+		printf("Task: EDF admission failed for '%s' on CPU %d (%d + %d > %d of %d)\n",
+				task->name, cpu->id, used, util, EDF_UTIL_MAX, EDF_UTIL_SCALE);
+		return -1;
+	}
+
+	task->rt.runtime = runtime_us * NSEC_PER_USEC;
+	task->rt.deadline = deadline_us * NSEC_PER_USEC;
+	task->rt.period = period_us * NSEC_PER_USEC;
+	task->rt.util = util;
+	task->rt.release = ktime_get_ns();
+	task->rt.abs_deadline = task->rt.release + task->rt.deadline;
+	task->rt.budget = task->rt.runtime;
+	task->rt.throttled = 0;
+	// Текущая работа идёт с этого момента, её квант уже начат
+	task->stats.last_run = task->rt.release;
+	task->policy = TASK_POLICY_EDF;
+	cpu->rq.edf_util += util;
+	spin_unlock_irqrestore(&cpu->rq.lock, flags);
+	return 0;
+}
+
+// Конец работы: ждём следующего выпуска. Если отстали больше чем на
+// период, пропущенные выпуски не навёрстываем
+void task_edf_yield(void) {
+	thread_control_block_t* task = current_task_TCB;
+	if (task->policy != TASK_POLICY_EDF) {
+		schedule();
+		return;
+	}
+
+	uint32_t flags = irq_save();
+	cpu_t* cpu = this_cpu();
+	spin_lock(&cpu->rq.lock);
+	uint64_t now = ktime_get_ns();
+	task->rt.jobs++;
+	if ((int64_t)(now - task->rt.abs_deadline) > 0) {
+		task->rt.misses++;
+	}
+	task->rt.release += task->rt.period;
+	if ((int64_t)(now - task->rt.release) > 0) {
+		uint64_t behind = div64_32(now - task->rt.release, task->rt.period) + 1;
+		task->rt.release += behind * task->rt.period;
+	}
+	task->state = TASK_STATE_BLOCKED;
+	spin_unlock(&cpu->rq.lock);
+
+	task_edf_arm(task);
+	schedule();
+	irq_restore(flags);
+}
+
+// Из прерывания таймера на каждом CPU: EDF-задача, исчерпавшая бюджет,
+// снимается до следующего периода
+void task_tick(void) {
+	cpu_t* cpu = this_cpu();
+	thread_control_block_t* task = cpu->current;
+	if (task->policy != TASK_POLICY_EDF) {
+		return;
+	}
+
+	spin_lock(&cpu->rq.lock);
+	int throttle = task->state == TASK_STATE_RUNNING &&
+		task->rt.budget <= (int64_t)(ktime_get_ns() - task->stats.last_run);
+	if (throttle) {
+		task->rt.throttled = 1;
+		task->rt.release += task->rt.period;
+		task->state = TASK_STATE_BLOCKED;
+		// Снимаем на выходе из прерывания, даже если тик пришёл посреди softirq
+		cpu->need_resched = 1;
+	}
+	spin_unlock(&cpu->rq.lock);
+
+	if (throttle) {
+		task_edf_arm(task);
+	}
+}
@@ -1,171 +1,419 @@
-#include <timer.h>
-#include <x86.h>
-#include <pic.h>
-#include <lib/stdio.h>
-#include <kheap.h>
-#include <list.h>
-#include <panic.h>
-#include <task.h>
-
-#define PIT_CMD_PORT 0x43
-#define PIT_DATA_PORT 0x40
-#define PIT_FREQ 1193180
-
-system_timer_t system_timer = {0, TIMER_FREQ, 0};
-
-typedef struct timer_node {
-	timer_t timer;
-	list_head_t list;
-} timer_node_t;
-
-static LIST_HEAD(timer_list);
-
-static void pit_set_frequency(uint32_t hz) {
-	uint32_t divisor = PIT_FREQ / hz;
-	outb(PIT_CMD_PORT, 0x36);
-	outb(PIT_DATA_PORT, divisor & 0xFF);
-	outb(PIT_DATA_PORT, (divisor >> 8) & 0xFF);
-}
-
-void timer_init(void) {
-	if (system_timer.initialized) {
-		printf("Timer: Already initialized\n");
-		return;
-	}
-
-	system_timer.ticks = 0;
-	system_timer.frequency = TIMER_FREQ;
-	pit_set_frequency(system_timer.frequency);
-	system_timer.initialized = 1;
-
-	list_init(&timer_list);
-	pic_unmask_irq(0);
-
-	printf("Timer: System timer initialized at %d Hz\n", system_timer.frequency);
-}
-
-uint32_t timer_get_ticks(void) {
-	if (!system_timer.initialized) {
-		printf("Timer: Warning - accessing ticks before initialization\n");
-		return 0;
-	}
-	return system_timer.ticks;
-}
-
-void timer_create(timer_t *timer, uint32_t milliseconds, void (*callback)(void), uint8_t periodic) {
-	if (!system_timer.initialized) {
-		printf("Timer: System timer not initialized, cannot create timer\n");
-		return;
-	}
-
-	timer_node_t *node = (timer_node_t *)kmalloc(sizeof(timer_node_t));
-	if (!node) {
-		panic_custom("Failed to allocate memory for new timer");
-	}
-
-	uint32_t delta = (milliseconds * system_timer.frequency) / 1000;
-	timer->expires = system_timer.ticks + delta;
-	if (timer->expires < system_timer.ticks) {
-		kfree(node);
-		panic_custom("Timer overflow detected: requested delay too large");
-	}
-	timer->callback = callback;
-	timer->active = 1;
-	timer->periodic = periodic;
-	timer->interval = delta;
-
-	cli();
-	node->timer = *timer;
-	list_add(&node->list, &timer_list);
-	sti();
-
-	//printf("Timer: Created %s timer for %d ms at tick %d\n", 
-	//       periodic ? "periodic" : "one-shot", milliseconds, timer->expires);
-}
-
-void timer_update(timer_t *timer) {
-	if (timer->active && system_timer.ticks >= timer->expires) {
-		timer->callback();
-		if (timer->periodic) {
-			timer->expires = system_timer.ticks + timer->interval;
-			if (timer->expires < system_timer.ticks) {
-				timer->expires = 0xFFFFFFFF;
-			}
-		} else {
-			timer->active = 0;
-		}
-	}
-}
-
-void timer_interrupt_handler(void) {
-    system_timer.ticks++;
-
-    list_head_t *pos, *n;
-    list_for_each_safe(pos, n, &timer_list) {
-        timer_node_t *node = list_entry(pos, timer_node_t, list);
-        if (node->timer.active) {
-            timer_update(&node->timer);
-            if (!node->timer.active) {
-                cli();
-                list_del(&node->list);
-                kfree(node);
-                sti();
-            }
-        }
-    }
-
-    thread_control_block_t* task = current_task_TCB;
-    if (task) {
-        thread_control_block_t* start = task;
-        do {
-            if (task->sleeping && task->sleep_timer.active) {
-                timer_update(&task->sleep_timer);
-                if (!task->sleep_timer.active) {
-                    cli();
-                    task->sleeping = 0;
-                    task->state = TASK_STATE_READY;
-                    sti();
-                }
-            }
-            task = task->next;
-        } while (task != start);
-    }
-
-    // Добавляем планировщик сюда
-    schedule();
-}
-
-void sleep(uint32_t milliseconds) {
-	if (!system_timer.initialized) {
-		printf("Timer: Cannot sleep, system timer not initialized\n");
-		return;
-	}
-	if (milliseconds == 0 || !current_task_TCB) {
-		return;
-	}
-
-	timer_create(&current_task_TCB->sleep_timer, milliseconds, sleep_callback, 0);
-	cli();
-	current_task_TCB->sleeping = 1;
-	current_task_TCB->state = TASK_STATE_BLOCKED;
-	sti();
-
-	schedule();
-}
-
-void sleep_callback(void) {
-}
-
-void usleep(uint32_t microseconds) {
-	if (!system_timer.initialized) {
-		printf("Timer: Cannot usleep, system timer not initialized\n");
-		return;
-	}
-	if (microseconds == 0) {
-		return;
-	}
-
-	uint32_t milliseconds = (microseconds + 999) / 1000;
-	if (milliseconds == 0) milliseconds = 1;
-	sleep(milliseconds);
+#include <timer.h>
+#include <x86.h>
+#include <irq.h>
+#include <lib/stdio.h>
+#include <kheap.h>
+#include <list.h>
+#include <panic.h>
+#include <task.h>
+#include <clocksource.h>
+#include <smp.h>
+#include <spinlock.h>
+#include <softirq.h>
+
+#define PIT_CMD_PORT 0x43
+#define PIT_DATA_PORT 0x40
+#define PIT_FREQ 1193180
+#define PIT_MAX_COUNT 0xFFFF
+
+system_timer_t system_timer = {0, TIMER_FREQ, 0};
+
+#define TIMER_INDEX(level) ((wheel_ticks >> (TVR_BITS + (level) * TVN_BITS)) & TVN_MASK)
+
+static list_head_t tv1[TVR_SIZE];
+static list_head_t tvn[4][TVN_SIZE];
+// Следующий тик, который ещё не обработан колесом
+static uint32_t wheel_ticks = 0;
+// Спящие задачи, упорядоченные по тику пробуждения
+static LIST_HEAD(sleep_queue);
+// Колесо и очередь сна; обрабатывает их softirq таймера на BSP
+static ticket_lock_t timer_lock = TICKET_LOCK_INIT;
+// Таймер, обработчик которого сейчас выполняется; только сравнивается
+// с указателем, разыменовывать его нельзя
+static timer_t *running_timer = NULL;
+
+static uint32_t pit_oneshot_count = 0;
+
+static void pit_set_frequency(uint32_t hz) {
+	uint32_t divisor = PIT_FREQ / hz;
+	outb(PIT_CMD_PORT, 0x36);
+	outb(PIT_DATA_PORT, divisor & 0xFF);
+	outb(PIT_DATA_PORT, (divisor >> 8) & 0xFF);
+}
+
+// Режим 0: одно прерывание по окончании счёта
+static void pit_set_oneshot(uint32_t ticks) {
+	pit_oneshot_count = ticks * (PIT_FREQ / system_timer.frequency);
+	outb(PIT_CMD_PORT, 0x30);
+	outb(PIT_DATA_PORT, pit_oneshot_count & 0xFF);
+	outb(PIT_DATA_PORT, (pit_oneshot_count >> 8) & 0xFF);
+}
+
+static uint32_t pit_elapsed(void) {
+	outb(PIT_CMD_PORT, 0x00);
+	uint32_t count = inb(PIT_DATA_PORT);
+	count |= inb(PIT_DATA_PORT) << 8;
+	// После конца счёта счётчик продолжает убывать с 0xFFFF
+	uint32_t cycles = count <= pit_oneshot_count ? pit_oneshot_count - count : pit_oneshot_count;
+	return cycles / (PIT_FREQ / system_timer.frequency);
+}
+
+static clock_event_t pit_clock_event = {
+	.name = "pit",
+	.max_ticks = 0,
+	.set_periodic = pit_set_frequency,
+	.set_oneshot = pit_set_oneshot,
+	.elapsed = pit_elapsed,
+};
+
+static clock_event_t *clock_event = &pit_clock_event;
+// Сколько тиков запрограммировано в однократном режиме; 0 - тик идёт
+static volatile uint32_t tick_stopped = 0;
+
+static void timer_softirq(void);
+
+void timer_init(void) {
+	if (system_timer.initialized) {
+		printf("Timer: Already initialized\n");
+		return;
+	}
+
+	system_timer.ticks = 0;
+	system_timer.frequency = TIMER_FREQ;
+	pit_clock_event.max_ticks = PIT_MAX_COUNT / (PIT_FREQ / system_timer.frequency);
+	clock_event->set_periodic(system_timer.frequency);
+	system_timer.initialized = 1;
+
+	for (int i = 0; i < TVR_SIZE; i++) {
+		list_init(&tv1[i]);
+	}
+	for (int level = 0; level < 4; level++) {
+		for (int i = 0; i < TVN_SIZE; i++) {
+			list_init(&tvn[level][i]);
+		}
+	}
+	wheel_ticks = 0;
+	list_init(&sleep_queue);
+	open_softirq(SOFTIRQ_TIMER, timer_softirq);
+	irq_unmask(0);
+
+	printf("Timer: System timer initialized at %d Hz\n", system_timer.frequency);
+}
+
+uint32_t timer_get_ticks(void) {
+	if (!system_timer.initialized) {
+		printf("Timer: Warning - accessing ticks before initialization\n");
+		return 0;
+	}
+	return system_timer.ticks;
+}
+
+uint32_t timer_ms_to_ticks(uint32_t milliseconds) {
+	return (milliseconds * system_timer.frequency + 999) / 1000;
+}
+
+static void wheel_add(timer_t *timer) {
+	uint32_t expires = timer->expires;
+	uint32_t idx = expires - wheel_ticks;
+	list_head_t *vec;
+
+	if ((int32_t)idx < 0) {
+		vec = &tv1[wheel_ticks & TVR_MASK];
+	} else if (idx < TVR_SIZE) {
+		vec = &tv1[expires & TVR_MASK];
+	} else if (idx < 1u << (TVR_BITS + TVN_BITS)) {
+		vec = &tvn[0][(expires >> TVR_BITS) & TVN_MASK];
+	} else if (idx < 1u << (TVR_BITS + 2 * TVN_BITS)) {
+		vec = &tvn[1][(expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK];
+	} else if (idx < 1u << (TVR_BITS + 3 * TVN_BITS)) {
+		vec = &tvn[2][(expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK];
+	} else {
+		vec = &tvn[3][(expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK];
+	}
+	list_add_tail(&timer->entry, vec);
+}
+
+// Переносит таймеры слота старшего уровня на уровни ниже
+static uint32_t wheel_cascade(int level, uint32_t index) {
+	list_head_t *vec = &tvn[level][index];
+	while (!list_empty(vec)) {
+		timer_t *timer = list_entry(vec->next, timer_t, entry);
+		list_del(&timer->entry);
+		wheel_add(timer);
+	}
+	return index;
+}
+
+// Под timer_lock с сохранёнными в *flags прерываниями
+static void wheel_run(uint32_t *flags) {
+	while ((int32_t)(system_timer.ticks - wheel_ticks) >= 0) {
+		uint32_t index = wheel_ticks & TVR_MASK;
+		if (!index && !wheel_cascade(0, TIMER_INDEX(0)) &&
+			!wheel_cascade(1, TIMER_INDEX(1)) && !wheel_cascade(2, TIMER_INDEX(2))) {
+			wheel_cascade(3, TIMER_INDEX(3));
+		}
+		wheel_ticks++;
+
+		list_head_t *vec = &tv1[index];
+		while (!list_empty(vec)) {
+			timer_t *timer = list_entry(vec->next, timer_t, entry);
+			list_del(&timer->entry);
+			// Периодический перевзводим до вызова: после него таймер
+			// может быть уже освобождён обработчиком
+			if (timer->interval) {
+				timer->expires += timer->interval;
+				wheel_add(timer);
+			}
+			void (*callback)(void *data) = timer->callback;
+			void *data = timer->data;
+			running_timer = timer;
+			// Обработчик может перевзвести таймер, поэтому зовём его без
+			// блокировки и с разрешёнными прерываниями
+			ticket_unlock_irqrestore(&timer_lock, *flags);
+			callback(data);
+			*flags = ticket_lock_irqsave(&timer_lock);
+			running_timer = NULL;
+		}
+	}
+}
+
+static void timer_softirq(void) {
+	uint32_t flags = ticket_lock_irqsave(&timer_lock);
+	wheel_run(&flags);
+
+	while (!list_empty(&sleep_queue)) {
+		thread_control_block_t* task = list_entry(sleep_queue.next, thread_control_block_t, sleep_list);
+		if ((int32_t)(system_timer.ticks - task->wake_tick) < 0) {
+			break;
+		}
+		list_del(&task->sleep_list);
+		task->sleeping = 0;
+		task_wake(task);
+	}
+	ticket_unlock_irqrestore(&timer_lock, flags);
+}
+
+void timer_setup(timer_t *timer, void (*callback)(void *data), void *data) {
+	timer->entry.next = NULL;
+	timer->entry.prev = NULL;
+	timer->expires = 0;
+	timer->interval = 0;
+	timer->callback = callback;
+	timer->data = data;
+}
+
+int timer_pending(const timer_t *timer) {
+	return timer->entry.next != NULL;
+}
+
+void timer_add(timer_t *timer, uint32_t expires) {
+	timer_mod(timer, expires);
+}
+
+int timer_mod(timer_t *timer, uint32_t expires) {
+	uint32_t flags = ticket_lock_irqsave(&timer_lock);
+	int pending = timer_pending(timer);
+	if (pending) {
+		list_del(&timer->entry);
+	}
+	timer->expires = expires;
+	wheel_add(timer);
+	ticket_unlock_irqrestore(&timer_lock, flags);
+	return pending;
+}
+
+int timer_cancel(timer_t *timer) {
+	uint32_t flags = ticket_lock_irqsave(&timer_lock);
+	int pending = timer_pending(timer);
+	if (pending) {
+		list_del(&timer->entry);
+	}
+	ticket_unlock_irqrestore(&timer_lock, flags);
+	return pending;
+}
+
+// Снимает таймер и дожидается конца его обработчика, если тот уже
+// запущен: после возврата память таймера можно освобождать. Из
+// обработчика этого же таймера ждать нельзя, там хватит timer_cancel
+int timer_cancel_sync(timer_t *timer) {
+	int pending = 0;
+	while (1) {
+		uint32_t flags = ticket_lock_irqsave(&timer_lock);
+		if (timer_pending(timer)) {
+			list_del(&timer->entry);
+			pending = 1;
+		}
+		// Колесо разбирает softirq на BSP: если мы сами в нём, обработчик
+		// этого таймера уже не идёт или это мы и есть
+		int running = running_timer == timer && !(in_softirq() && smp_processor_id() == 0);
+		ticket_unlock_irqrestore(&timer_lock, flags);
+		if (!running) {
+			return pending;
+		}
+		cpu_relax();
+	}
+}
+
+void timer_set_clock_event(clock_event_t *event) {
+	uint32_t flags = irq_save();
+	clock_event = event;
+	tick_stopped = 0;
+	clock_event->set_periodic(system_timer.frequency);
+	irq_restore(flags);
+	printf("Timer: Using clock event device '%s'\n", event->name);
+}
+
+// Тиков до ближайшего события, не больше limit. Просматриваются только
+// ближние слоты колеса; каскад старших уровней считается событием
+static uint32_t timer_next_event(uint32_t limit) {
+	uint32_t delta = limit;
+
+	if (!list_empty(&sleep_queue)) {
+		thread_control_block_t* task = list_entry(sleep_queue.next, thread_control_block_t, sleep_list);
+		int32_t left = (int32_t)(task->wake_tick - system_timer.ticks);
+		if (left <= 0) {
+			return 0;
+		}
+		if ((uint32_t)left < delta) {
+			delta = left;
+		}
+	}
+
+	for (uint32_t i = 0; i < delta; i++) {
+		uint32_t tick = system_timer.ticks + 1 + i;
+		if ((int32_t)(tick - wheel_ticks) < 0) {
+			continue;
+		}
+		if (!(tick & TVR_MASK) || !list_empty(&tv1[tick & TVR_MASK])) {
+			return i + 1;
+		}
+	}
+	return delta;
+}
+
+// Выход из однократного режима: досчитываем пропущенные тики
+// и возвращаем периодический режим
+static void timer_tick_restart(uint32_t elapsed) {
+	system_timer.ticks += elapsed;
+	tick_stopped = 0;
+	clock_event->set_periodic(system_timer.frequency);
+}
+
+// Из прерывания, разбудившего BSP посреди остановленного тика: время
+// нужно догнать до того, как irq_exit() переключится на другую задачу
+void timer_irq_catchup(void) {
+	if (tick_stopped && smp_processor_id() == 0) {
+		timer_tick_restart(clock_event->elapsed());
+		// Пропущенные тики могли просрочить таймеры и сон
+		raise_softirq(SOFTIRQ_TIMER);
+	}
+}
+
+void timer_idle(void) {
+	// Оставшееся после лимита перезапусков доделываем до сна
+	do_softirq();
+	cli();
+	if (task_ready_pending() || softirq_pending()) {
+		sti();
+		return;
+	}
+
+	// Останавливать тик можно, только пока простаивают и остальные CPU:
+	// прерывания устройств приходят на BSP, так что разбудить их, кроме
+	// него, некому, и новых таймеров с устаревшим ticks они не заведут
+	uint32_t delta = 0;
+	if (clock_event->set_oneshot && clock_event->max_ticks > 1 && smp_others_idle()) {
+		ticket_lock(&timer_lock);
+		delta = timer_next_event(clock_event->max_ticks);
+		ticket_unlock(&timer_lock);
+	}
+	if (delta > 1) {
+		tick_stopped = delta;
+		clock_event->set_oneshot(delta);
+	}
+
+	asm volatile("sti; hlt");
+
+	// Разбудило не прерывание таймера
+	cli();
+	if (tick_stopped) {
+		timer_tick_restart(clock_event->elapsed());
+	}
+	sti();
+}
+
+// Аппаратная часть только считает тик; колесо и очередь сна
+// разбирает softirq уже с разрешёнными прерываниями
+void timer_interrupt_handler(void) {
+	// На AP таймер LAPIC нужен только для вытеснения
+	if (smp_processor_id() == 0) {
+		if (tick_stopped) {
+			timer_tick_restart(tick_stopped - 1);
+		}
+		system_timer.ticks++;
+		raise_softirq(SOFTIRQ_TIMER);
+	}
+
+	// Каждый тик - точка вытеснения для задач равного приоритета
+	this_cpu()->need_resched = 1;
+	task_tick();
+	irq_exit();
+}
+
+void sleep(uint32_t milliseconds) {
+	if (!system_timer.initialized) {
+		printf("Timer: Cannot sleep, system timer not initialized\n");
+		return;
+	}
+	if (milliseconds == 0 || !current_task_TCB) {
+		return;
+	}
+
+	uint32_t delta = timer_ms_to_ticks(milliseconds);
+	thread_control_block_t* task = current_task_TCB;
+
+	// Вставка с хвоста: новые сроки обычно самые поздние
+	uint32_t flags = ticket_lock_irqsave(&timer_lock);
+	task->wake_tick = system_timer.ticks + delta;
+	list_head_t *pos = sleep_queue.prev;
+	while (pos != &sleep_queue) {
+		thread_control_block_t* other = list_entry(pos, thread_control_block_t, sleep_list);
+		if ((int32_t)(other->wake_tick - task->wake_tick) <= 0) {
+			break;
+		}
+		pos = pos->prev;
+	}
+	list_add(&task->sleep_list, pos);
+	task->sleeping = 1;
+	task->state = TASK_STATE_BLOCKED;
+	ticket_unlock(&timer_lock);
+	schedule();
+	irq_restore(flags);
+}
+
+void usleep(uint32_t microseconds) {
+	if (!system_timer.initialized) {
+		printf("Timer: Cannot usleep, system timer not initialized\n");
+		return;
+	}
+	if (microseconds == 0) {
+		return;
+	}
+
+	if (!clocksource_get()) {
+		uint32_t milliseconds = (microseconds + 999) / 1000;
+		sleep(milliseconds);
+		return;
+	}
+
+	// Длинный сон отдаём планировщику, не доходя до срока меньше чем
+	// на тик; остаток и короткие задержки дожидаемся по TSC
+	uint64_t deadline = ktime_get_ns() + (uint64_t)microseconds * NSEC_PER_USEC;
+	uint32_t tick_us = 1000000 / system_timer.frequency;
+	if (microseconds > 2 * tick_us && current_task_TCB) {
+		sleep((microseconds - tick_us) / 1000);
+	}
+	while ((int64_t)(deadline - ktime_get_ns()) > 0) {
+		cpu_relax();
+	}
 }
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include <vmm.h>
+#include <pmm.h>
+#include <interrupts.h>
+#include <smp.h>
+#include <task.h>
+#include <spinlock.h>
+#include <lib/string.h>
+#include <lib/stdio.h>
+#include <x86.h>
+#include <panic.h>
+
+static uint32_t *kernel_directory = NULL;
+static uint32_t cr4_features = 0;
+static uint32_t global_flag = 0;
+static uint32_t identity_end = 0;
+static uint32_t vmalloc_map[VMM_VMALLOC_PAGES / 32];
+static uint32_t vmalloc_hint = 0;
+static spinlock_t vmm_lock = SPINLOCK_INIT;
+
+static uint32_t *vmm_table(uint32_t virt, int create) {
+	uint32_t *pde = &kernel_directory[virt >> 22];
+	if (*pde & VMM_LARGE) {
+		return NULL;
+	}
+	if (!(*pde & VMM_PRESENT)) {
+		if (!create) {
+			return NULL;
+		}
+		uint32_t *table = (uint32_t *)pmm_alloc_zeroed(1);
+		if (!table) {
+			return NULL;
+		}
+		*pde = (uint32_t)table | VMM_PRESENT | VMM_WRITE;
+	}
+	return (uint32_t *)(*pde & VMM_FRAME_MASK);
+}
+
+// Конечная запись для адреса: большая PDE или PTE, 0 если её нет
+static uint32_t vmm_entry(uint32_t virt) {
+	uint32_t pde = kernel_directory[virt >> 22];
+	if (!(pde & VMM_PRESENT) || (pde & VMM_LARGE)) {
+		return pde;
+	}
+	return ((uint32_t *)(pde & VMM_FRAME_MASK))[(virt >> 12) & 0x3FF];
+}
+
+static int vmm_map_large(uint32_t addr, uint32_t flags) {
+	uint32_t *pde = &kernel_directory[addr >> 22];
+	if (*pde & VMM_PRESENT) {
+		return 0;
+	}
+
+	flags |= VMM_PRESENT | VMM_WRITE | global_flag;
+	if (cr4_features & CR4_PSE) {
+		*pde = addr | flags | VMM_LARGE;
+		return 0;
+	}
+
+	// Без PSE те же 4 МБ набираем таблицей из 4 КБ страниц
+	uint32_t *table = (uint32_t *)pmm_alloc_zeroed(1);
+	if (!table) {
+		return -1;
+	}
+	for (uint32_t i = 0; i < VMM_ENTRIES; i++) {
+		table[i] = (addr + i * PAGE_SIZE) | flags;
+	}
+	*pde = (uint32_t)table | VMM_PRESENT | VMM_WRITE;
+	return 0;
+}
+
+static int vmm_map_locked(uint32_t virt, uint32_t phys, uint32_t flags) {
+	uint32_t *table = vmm_table(virt, 1);
+	if (!table) {
+		return -1;
+	}
+	if (!global_flag) {
+		flags &= ~VMM_GLOBAL;
+	}
+
+	uint32_t *pte = &table[(virt >> 12) & 0x3FF];
+	int remap = *pte & VMM_PRESENT;
+	*pte = phys | (flags & 0xFFF) | VMM_PRESENT;
+	return remap;
+}
+
+static void vmm_flush_all(void) {
+	// Глобальные записи переживают перезагрузку CR3, их сбрасывает только переключение PGE
+	if (cr4_features & CR4_PGE) {
+		uint32_t cr4 = read_cr4();
+		write_cr4(cr4 & ~CR4_PGE);
+		write_cr4(cr4);
+	} else {
+		write_cr3(read_cr3());
+	}
+}
+
+void vmm_flush_range(uint32_t start, uint32_t pages) {
+	if (pages > VMM_FLUSH_ALL_PAGES) {
+		vmm_flush_all();
+		return;
+	}
+	for (uint32_t i = 0; i < pages; i++) {
+		invlpg(start + i * PAGE_SIZE);
+	}
+}
+
+// Сброс на всех процессорах; вызывать без захваченных спинлоков
+static void vmm_shootdown(uint32_t start, uint32_t pages) {
+	vmm_flush_range(start, pages);
+	smp_tlb_shootdown(start, pages);
+}
+
+static int vmm_page_fault(registers_t *regs) {
+	uint32_t addr = read_cr2();
+	uint32_t entry = vmm_entry(addr);
+
+	// Отображение могло появиться на другом процессоре уже после промаха
+	// в TLB. Повторяем только отказ "нет страницы": нарушение прав или
+	// зарезервированные биты при верной записи повторились бы бесконечно
+	if (!(regs->err_code & PF_PRESENT) && (entry & VMM_PRESENT) &&
+		(!(regs->err_code & PF_WRITE) || (entry & VMM_WRITE)) &&
+		(!(regs->err_code & PF_USER) || (entry & VMM_USER))) {
+		invlpg(addr);
+		return 1;
+	}
+
+	thread_control_block_t *task = current_task_TCB;
+	const char *name = task ? task->name : "?";
+	if (vmm_is_guard(addr)) {
+		printf("VMM: Guard page hit at 0x%x in task '%s' (EIP=0x%x)\n", addr, name, regs->eip);
+	} else {
+		printf("VMM: Page fault at 0x%x (%s, %s) in task '%s' (EIP=0x%x)\n", addr,
+				(regs->err_code & PF_RESERVED) ? "reserved bit" :
+				(regs->err_code & PF_PRESENT) ? "protection" : "not present",
+				(regs->err_code & PF_WRITE) ? "write" : "read", name, regs->eip);
+	}
+	return 0;
+}
+
+void vmm_load(void) {
+	write_cr4(read_cr4() | cr4_features);
+	write_cr3((uint32_t)kernel_directory);
+	write_cr0(read_cr0() | CR0_PG | CR0_WP);
+}
+
+void vmm_init(void) {
+	uint32_t eax, ebx, ecx, edx;
+	cpuid(1, &eax, &ebx, &ecx, &edx);
+	if (edx & (1 << 3)) {
+		cr4_features |= CR4_PSE;
+	}
+	if (edx & (1 << 13)) {
+		cr4_features |= CR4_PGE;
+		global_flag = VMM_GLOBAL;
+	}
+
+	kernel_directory = (uint32_t *)pmm_alloc_zeroed(1);
+	if (!kernel_directory) {
+		panic_custom("VMM: Failed to allocate page directory");
+	}
+
+	uint64_t max = pmm_get_max_address();
+	if (max > VMM_VMALLOC_START) {
+		panic_custom("VMM: Physical memory overlaps the vmalloc area");
+	}
+	identity_end = (uint32_t)((max + VMM_LARGE_PAGE_SIZE - 1) & ~(uint64_t)(VMM_LARGE_PAGE_SIZE - 1));
+	if (vmm_identity_map(0, identity_end, 0) < 0) {
+		panic_custom("VMM: Failed to build identity map");
+	}
+
+	isr_register_handler(14, vmm_page_fault);
+	vmm_load();
+
+	printf("VMM: Identity mapped %d MB with %s pages%s, vmalloc at 0x%x-0x%x\n",
+			identity_end >> 20, (cr4_features & CR4_PSE) ? "4 MB" : "4 KB",
+			global_flag ? " (global)" : "", VMM_VMALLOC_START, VMM_VMALLOC_END);
+}
+
+uint32_t vmm_directory(void) {
+	return (uint32_t)kernel_directory;
+}
+
+// Один к одному, большими страницами; уже отображённые куски не трогаем
+int vmm_identity_map(uint32_t phys, uint32_t size, uint32_t flags) {
+	if (!size) {
+		return 0;
+	}
+	uint64_t end = (uint64_t)phys + size;
+	if (end > VMM_VMALLOC_START && phys < VMM_VMALLOC_END) {
+		printf("VMM: Identity range 0x%x overlaps the vmalloc area\n", phys);
+		return -1;
+	}
+
+	uint32_t lock_flags = spin_lock_irqsave(&vmm_lock);
+	for (uint64_t addr = phys & ~(VMM_LARGE_PAGE_SIZE - 1); addr < end; addr += VMM_LARGE_PAGE_SIZE) {
+		if (vmm_map_large((uint32_t)addr, flags) < 0) {
+			spin_unlock_irqrestore(&vmm_lock, lock_flags);
+			printf("VMM: Out of memory mapping 0x%x\n", (uint32_t)addr);
+			return -1;
+		}
+	}
+	spin_unlock_irqrestore(&vmm_lock, lock_flags);
+	return 0;
+}
+
+int vmm_map(uint32_t virt, uint32_t phys, uint32_t flags) {
+	if ((virt | phys) & (PAGE_SIZE - 1)) {
+		printf("VMM: Unaligned mapping 0x%x -> 0x%x\n", virt, phys);
+		return -1;
+	}
+
+	uint32_t lock_flags = spin_lock_irqsave(&vmm_lock);
+	int remap = vmm_map_locked(virt, phys, flags);
+	spin_unlock_irqrestore(&vmm_lock, lock_flags);
+
+	if (remap < 0) {
+		printf("VMM: Cannot map 0x%x\n", virt);
+		return -1;
+	}
+	// Новую запись TLB не держит, а старую надо выбросить везде
+	if (remap) {
+		vmm_shootdown(virt, 1);
+	}
+	return 0;
+}
+
+void vmm_unmap(uint32_t virt) {
+	virt &= ~(PAGE_SIZE - 1);
+	uint32_t lock_flags = spin_lock_irqsave(&vmm_lock);
+	uint32_t *table = vmm_table(virt, 0);
+	if (!table || !(table[(virt >> 12) & 0x3FF] & VMM_PRESENT)) {
+		spin_unlock_irqrestore(&vmm_lock, lock_flags);
+		return;
+	}
+	table[(virt >> 12) & 0x3FF] = 0;
+	spin_unlock_irqrestore(&vmm_lock, lock_flags);
+
+	vmm_shootdown(virt, 1);
+}
+
+uint32_t vmm_translate(uint32_t virt) {
+	uint32_t entry = vmm_entry(virt);
+	if (!(entry & VMM_PRESENT)) {
+		return 0;
+	}
+	if (entry & VMM_LARGE) {
+		return (entry & ~(VMM_LARGE_PAGE_SIZE - 1)) | (virt & (VMM_LARGE_PAGE_SIZE - 1));
+	}
+	return (entry & VMM_FRAME_MASK) | (virt & (PAGE_SIZE - 1));
+}
+
+static inline int vmalloc_test(uint32_t index) {
+	return vmalloc_map[index / 32] & (1u << (index % 32));
+}
+
+static void vmalloc_mark(uint32_t first, uint32_t count, int used) {
+	for (uint32_t i = first; i < first + count; i++) {
+		if (used) {
+			vmalloc_map[i / 32] |= 1u << (i % 32);
+		} else {
+			vmalloc_map[i / 32] &= ~(1u << (i % 32));
+		}
+	}
+}
+
+static int32_t vmalloc_find(uint32_t count) {
+	uint32_t run = 0;
+	uint32_t i = vmalloc_hint;
+	for (uint32_t n = 0; n < VMM_VMALLOC_PAGES + count; n++, i++) {
+		if (i == VMM_VMALLOC_PAGES) {
+			i = 0;
+			run = 0;
+		}
+		if (vmalloc_test(i)) {
+			run = 0;
+		} else if (++run == count) {
+			return i + 1 - count;
+		}
+	}
+	return -1;
+}
+
+// Страницы не обязаны быть смежными физически. Под каждым блоком остаётся
+// неотображённая сторожевая страница: стек, выросший за свой низ, упрётся в неё
+void *vmm_alloc(uint32_t pages) {
+	if (!pages || pages >= VMM_VMALLOC_PAGES) {
+		return NULL;
+	}
+
+	uint32_t flags = spin_lock_irqsave(&vmm_lock);
+	int32_t first = vmalloc_find(pages + 1);
+	if (first < 0) {
+		spin_unlock_irqrestore(&vmm_lock, flags);
+		printf("VMM: Out of virtual space for %d pages\n", pages);
+		return NULL;
+	}
+	vmalloc_mark(first, pages + 1, 1);
+	vmalloc_hint = first + pages + 1;
+
+	uint32_t base = VMM_VMALLOC_START + (first + 1) * PAGE_SIZE;
+	uint32_t mapped = 0;
+	for (; mapped < pages; mapped++) {
+		void *frame = pmm_alloc(1);
+		if (!frame) {
+			break;
+		}
+		if (vmm_map_locked(base + mapped * PAGE_SIZE, (uint32_t)frame, VMM_WRITE | VMM_GLOBAL) < 0) {
+			pmm_free(frame, 1);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&vmm_lock, flags);
+
+	if (mapped < pages) {
+		vmm_free((void *)base, pages);
+		return NULL;
+	}
+	return (void *)base;
+}
+
+void vmm_free(void *addr, uint32_t pages) {
+	uint32_t virt = (uint32_t)addr;
+	if ((virt & (PAGE_SIZE - 1)) || virt < VMM_VMALLOC_START + PAGE_SIZE ||
+		pages >= VMM_VMALLOC_PAGES || virt + pages * PAGE_SIZE > VMM_VMALLOC_END) {
+		printf("VMM: Invalid free of 0x%x (%d pages)\n", virt, pages);
+		return;
+	}
+
+	// Сначала снимаем только бит присутствия и сбрасываем TLB везде;
+	// кадры отдаём после, иначе чужой TLB писал бы в уже выданную память
+	uint32_t flags = spin_lock_irqsave(&vmm_lock);
+	for (uint32_t i = 0; i < pages; i++) {
+		uint32_t *table = vmm_table(virt + i * PAGE_SIZE, 0);
+		if (table) {
+			table[((virt >> 12) + i) & 0x3FF] &= ~VMM_PRESENT;
+		}
+	}
+	spin_unlock_irqrestore(&vmm_lock, flags);
+
+	vmm_shootdown(virt, pages);
+
+	flags = spin_lock_irqsave(&vmm_lock);
+	for (uint32_t i = 0; i < pages; i++) {
+		uint32_t *table = vmm_table(virt + i * PAGE_SIZE, 0);
+		if (table) {
+			uint32_t *pte = &table[((virt >> 12) + i) & 0x3FF];
+			if (*pte & VMM_FRAME_MASK) {
+				pmm_free((void *)(*pte & VMM_FRAME_MASK), 1);
+			}
+			*pte = 0;
+		}
+	}
+	uint32_t first = (virt - VMM_VMALLOC_START) / PAGE_SIZE - 1;
+	vmalloc_mark(first, pages + 1, 0);
+	if (first < vmalloc_hint) {
+		vmalloc_hint = first;
+	}
+	spin_unlock_irqrestore(&vmm_lock, flags);
+}
+
+int vmm_is_guard(uint32_t virt) {
+	if (virt < VMM_VMALLOC_START || virt >= VMM_VMALLOC_END || !kernel_directory) {
+		return 0;
+	}
+	return vmalloc_test((virt - VMM_VMALLOC_START) / PAGE_SIZE) && !(vmm_entry(virt) & VMM_PRESENT);
+}
@@ -0,0 +1,91 @@
+#include <workqueue.h>
+#include <kheap.h>
+#include <smp.h>
+#include <lib/stdio.h>
+#include <lib/string.h>
+
+static workqueue_t *system_wq = NULL;
+
+static void worker_thread(void) {
+	workqueue_t *wq = (workqueue_t *)current_task_TCB->data;
+
+	while (1) {
+		uint32_t flags = spin_lock_irqsave(&wq->lock);
+		if (list_empty(&wq->works)) {
+			current_task_TCB->state = TASK_STATE_BLOCKED;
+			spin_unlock(&wq->lock);
+			schedule();
+			irq_restore(flags);
+			continue;
+		}
+
+		work_t *work = list_entry(wq->works.next, work_t, entry);
+		list_del(&work->entry);
+		// Снимаем до вызова: работа может поставить себя в очередь снова
+		work->pending = 0;
+		spin_unlock_irqrestore(&wq->lock, flags);
+
+		work->func(work);
+	}
+}
+
+workqueue_t *workqueue_create(const char *name) {
+	workqueue_t *wq = (workqueue_t *)kmalloc(sizeof(workqueue_t));
+	if (!wq) {
+		printf("Workqueue: No memory for '%s'\n", name);
+		return NULL;
+	}
+	memset(wq, 0, sizeof(workqueue_t));
+	strncpy(wq->name, name, sizeof(wq->name) - 1);
+	spin_lock_init(&wq->lock);
+	list_init(&wq->works);
+
+	wq->worker = create_kernel_task_data(worker_thread, wq->name, 0, wq);
+	if (!wq->worker) {
+		printf("Workqueue: Failed to create worker for '%s'\n", name);
+		kfree(wq);
+		return NULL;
+	}
+	return wq;
+}
+
+void work_init(work_t *work, void (*func)(work_t *work), void *data) {
+	work->entry.next = NULL;
+	work->entry.prev = NULL;
+	work->func = func;
+	work->data = data;
+	work->pending = 0;
+}
+
+// Можно звать из обработчика прерывания. Возвращает 0, если работа
+// уже стоит в очереди и ещё не начата
+int queue_work(workqueue_t *wq, work_t *work) {
+	uint32_t flags = spin_lock_irqsave(&wq->lock);
+	if (work->pending) {
+		spin_unlock_irqrestore(&wq->lock, flags);
+		return 0;
+	}
+	work->pending = 1;
+	list_add_tail(&work->entry, &wq->works);
+	spin_unlock_irqrestore(&wq->lock, flags);
+
+	task_wake(wq->worker);
+	return 1;
+}
+
+int schedule_work(work_t *work) {
+	if (!system_wq) {
+		printf("Workqueue: System queue is not initialized\n");
+		return 0;
+	}
+	return queue_work(system_wq, work);
+}
+
+void workqueue_init(void) {
+	system_wq = workqueue_create("kworker");
+	if (!system_wq) {
+		printf("Workqueue: Failed to create system queue\n");
+		return;
+	}
+	printf("Workqueue: System worker '%s' started\n", system_wq->name);
+}